@@ -5,7 +5,8 @@
  */
 #include "common.h"
 
-/// Issue an ATA PASS-THROUGH (16) using SG_IO and ioctl.  Returns success.
+/// Issue an ATA PASS-THROUGH (16) using SG_IO and ioctl.  sg_fd stays open on failure; it belongs to the caller's
+/// ZoneDevice, which closes it once.  Returns success.
 bool ataPassthrough16(int* sg_fd, uint8_t cmd, uint16_t features, uint16_t count, uint64_t lba, uint8_t device, uint8_t protocol, uint8_t flags, int dxfer_dir, uint8_t* dxferp, unsigned int dxfer_len, uint8_t* sbp, unsigned char mx_sb_len){
 	uint8_t cdb[ATA_PASS_THROUGH_16_LEN] = {0};
 	sg_io_hdr_t io_hdr = {0};
@@ -35,7 +36,6 @@ bool ataPassthrough16(int* sg_fd, uint8_t cmd, uint16_t features, uint16_t count
 	io_hdr.timeout = SG_IO_TIMEOUT;
 	if (ioctl(*sg_fd, SG_IO, &io_hdr) < 0) {
 		perror("ioctl error");
-		close(*sg_fd);
 		return false;
 	}
 	return true;
@@ -4,6 +4,9 @@
  * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
  * Author: Austin Liou (austin.liou@wdc.com)
  */
+#ifndef ZACUTILS_COMMON_H
+#define ZACUTILS_COMMON_H
+
 #include <fcntl.h>
 #include <string.h>
 #include <sys/ioctl.h>
@@ -98,3 +101,5 @@ bool ataPassthrough16(
 	uint8_t* sbp,
 	unsigned char mx_sb_len
 );
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * CRC32C (Castagnoli) checksums of on-disk metadata and data
+ */
+#include <pthread.h>
+#include <string.h>
+#include "crc32c.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define CRC32C_HAVE_SSE42
+#endif
+
+static uint32_t crcTable[8][256];
+static uint32_t x2nTable[32];		// x^(2^n) mod P
+static bool useHardware;
+static pthread_once_t crcInitOnce = PTHREAD_ONCE_INIT;
+
+/// a*b mod P, in reflected bit order
+static uint32_t crc32cMultModP(uint32_t a, uint32_t b){
+	uint32_t m = 1u << 31;
+	uint32_t p = 0;
+	for (;;){
+		if (a & m){
+			p ^= b;
+			if ((a & (m - 1)) == 0){
+				break;
+			}
+		}
+		m >>= 1;
+		b = b & 1 ? (b >> 1) ^ CRC32C_POLY : b >> 1;
+	}
+	return p;
+}
+
+static void crc32cInit(){
+	for (uint32_t i=0; i<256; i++){
+		uint32_t crc = i;
+		for (int bit=0; bit<8; bit++){
+			crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+		}
+		crcTable[0][i] = crc;
+	}
+	for (uint32_t i=0; i<256; i++){
+		for (int k=1; k<8; k++){
+			crcTable[k][i] = (crcTable[k-1][i] >> 8) ^ crcTable[0][crcTable[k-1][i] & 0xff];
+		}
+	}
+	uint32_t p = 1u << 30;		// x^1
+	for (int n=0; n<32; n++){
+		x2nTable[n] = p;
+		p = crc32cMultModP(p, p);
+	}
+#ifdef CRC32C_HAVE_SSE42
+	useHardware = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+/// Slice-by-8: eight bytes per step through eight tables
+static uint32_t crc32cSoftware(uint32_t crc, const uint8_t* bytes, size_t len){
+	while (len > 0 && ((uintptr_t)bytes & 7) != 0){
+		crc = crcTable[0][(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+	while (len >= 8){
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		word ^= crc;
+		crc = crcTable[7][word & 0xff] ^ crcTable[6][(word >> 8) & 0xff]
+			^ crcTable[5][(word >> 16) & 0xff] ^ crcTable[4][(word >> 24) & 0xff]
+			^ crcTable[3][(word >> 32) & 0xff] ^ crcTable[2][(word >> 40) & 0xff]
+			^ crcTable[1][(word >> 48) & 0xff] ^ crcTable[0][word >> 56];
+		bytes += 8;
+		len -= 8;
+	}
+	while (len-- > 0){
+		crc = crcTable[0][(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+#ifdef CRC32C_HAVE_SSE42
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(uint32_t crc, const uint8_t* bytes, size_t len){
+	while (len > 0 && ((uintptr_t)bytes & 7) != 0){
+		crc = _mm_crc32_u8(crc, *bytes++);
+		len--;
+	}
+#ifdef __x86_64__
+	uint64_t crc64 = crc;
+	while (len >= 8){
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+		bytes += 8;
+		len -= 8;
+	}
+	crc = (uint32_t)crc64;
+#endif
+	while (len >= 4){
+		uint32_t word;
+		memcpy(&word, bytes, sizeof(word));
+		crc = _mm_crc32_u32(crc, word);
+		bytes += 4;
+		len -= 4;
+	}
+	while (len-- > 0){
+		crc = _mm_crc32_u8(crc, *bytes++);
+	}
+	return crc;
+}
+#endif
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t len){
+	pthread_once(&crcInitOnce, crc32cInit);
+#ifdef CRC32C_HAVE_SSE42
+	if (useHardware){
+		return ~crc32cSse42(~crc, (const uint8_t*)data, len);
+	}
+#endif
+	return ~crc32cSoftware(~crc, (const uint8_t*)data, len);
+}
+
+/// Returns whether crc32c uses the CPU's CRC32 instruction
+bool crc32cHardware(){
+	pthread_once(&crcInitOnce, crc32cInit);
+	return useHardware;
+}
+
+uint32_t crc32cShiftOp(uint64_t len){
+	pthread_once(&crcInitOnce, crc32cInit);
+	uint32_t p = 1u << 31;		// x^0
+	for (int n = 3; len > 0; len >>= 1, n++){	// x^(8*len)
+		if (len & 1){
+			p = crc32cMultModP(x2nTable[n & 31], p);
+		}
+	}
+	return p;
+}
+
+uint32_t crc32cCombineOp(uint32_t crcA, uint32_t crcB, uint32_t shiftOp){
+	return crc32cMultModP(shiftOp, crcA) ^ crcB;
+}
+
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, uint64_t lenB){
+	return crc32cCombineOp(crcA, crcB, crc32cShiftOp(lenB));
+}
@@ -0,0 +1,30 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for CRC32C (Castagnoli) checksums of on-disk metadata and data
+ */
+#ifndef ZACUTILS_CRC32C_H
+#define ZACUTILS_CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Reflected CRC32C polynomial
+#define CRC32C_POLY 0x82F63B78
+
+/// CRC32C of len bytes at data, continuing from crc (0 to start a new checksum).  Uses the SSE4.2 CRC32
+/// instruction when the CPU has it, else a slice-by-8 table implementation.
+uint32_t crc32c(uint32_t crc, const void* data, size_t len);
+
+bool crc32cHardware();
+
+/// Operator appending len bytes, for crc32cCombineOp
+uint32_t crc32cShiftOp(uint64_t len);
+
+/// CRC32C of A followed by B, given crcA, crcB and crc32cShiftOp(length of B)
+uint32_t crc32cCombineOp(uint32_t crcA, uint32_t crcB, uint32_t shiftOp);
+
+/// CRC32C of A followed by B, given crcA, crcB and the length of B
+uint32_t crc32cCombine(uint32_t crcA, uint32_t crcB, uint64_t lenB);
+
+#endif
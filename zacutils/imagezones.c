@@ -0,0 +1,286 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Write-pointer-aware zone imaging and restore tool.  Only the written range of each zone is copied.
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#include "imagezones.h"
+
+void usage(){
+	printf(	"Usage: imagezones [-?] [-r] [-j threads] [-m manifest] [-k] dev image\n"
+		"	-?	: Print out usage\n"
+		"	-r	: Restore image onto dev instead of imaging dev.  Optional.\n"
+		"	-j	: Number of parallel transfer threads (default: %d).  Optional.\n"
+		"	-m	: Zone manifest file (default: image.manifest).  Optional.\n"
+		"	-k	: Use kernel zoned block device ioctls instead of ATA PASS-THROUGH.  Optional.\n"
+		"	dev	: The device handle to open (e.g. /dev/sdb).  Required.\n"
+		"	image	: Sparse image file to write (or read with -r).  Required.\n",
+		IMAGE_DEFAULT_THREADS
+	);
+}
+
+/// Build one extent per zone covering its written range, at the same byte offset in source and destination.
+/// Offline zones cannot be read or written, so they are skipped with a warning (the manifest still records them).
+/// Returns the extents (to be freed by the caller), or NULL on failure.
+struct CopyExtent* writtenExtents(const struct ZoneTable* table, uint32_t sectorSize, uint32_t* numExtents){
+	struct CopyExtent* extents = (struct CopyExtent*) malloc(sizeof(struct CopyExtent) * (table->numZones ? table->numZones : 1));
+	if (!extents){
+		fprintf(stderr, "Error: Could not allocate extent list for %u zones\n", table->numZones);
+		return NULL;
+	}
+	*numExtents = 0;
+	for (uint32_t i=0; i<table->numZones; i++){
+		if (zoneTableCondition(table, i) == ZONECOND_OFFLINE){
+			fprintf(stderr, "Warning: Skipping OFFLINE zone starting at LBA %#lx\n", zoneTableStartLba(table, i));
+			continue;
+		}
+		uint64_t length = zoneTableWrittenLength(table, i);
+		if (length == 0){
+			continue;
+		}
+		struct CopyExtent* extent = &extents[(*numExtents)++];
+		extent->srcOffset = zoneTableStartLba(table, i) * sectorSize;
+		extent->dstOffset = extent->srcOffset;
+		extent->length = length * sectorSize;
+	}
+	return extents;
+}
+
+/// Image every zone's written range from deviceFile into a sparse imageFile, and save the zone manifest.
+int imageDevice(char* deviceFile, char* imageFile, char* manifestFile, int numThreads, enum ZoneBackends backend){
+	struct ZoneDevice dev;
+	if (!zoneDevOpen(&dev, deviceFile, backend)){
+		return 1;
+	}
+	uint32_t sectorSize = dev.sectorSize;
+	struct ReportZonesHeader zoneHeader;
+	struct ZoneTable zoneTable;
+	if (!zoneTableReportAll(&dev, &zoneTable, &zoneHeader)){
+		zoneDevClose(&dev);
+		return 1;
+	}
+	zoneDevClose(&dev);
+
+	uint64_t imageSectors = 0;
+	uint64_t writtenSectors = 0;
+	for (uint32_t i=0; i<zoneTable.numZones; i++){
+		uint64_t zoneEnd = zoneTableStartLba(&zoneTable, i) + zoneTableLength(&zoneTable, i);
+		imageSectors = zoneEnd > imageSectors ? zoneEnd : imageSectors;
+		writtenSectors += zoneTableWrittenLength(&zoneTable, i);
+	}
+
+	int devFd = open(deviceFile, O_RDONLY | O_DIRECT);
+	if (devFd < 0){
+		perror("Error opening device");
+		zoneTableFree(&zoneTable);
+		return 1;
+	}
+	int imageFd = open(imageFile, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (imageFd < 0 || ftruncate(imageFd, imageSectors * sectorSize) < 0){
+		perror("Error creating image");
+		close(devFd);
+		zoneTableFree(&zoneTable);
+		return 1;
+	}
+
+	printf("Imaging %u zones (%lu of %lu sectors written)...\n", zoneTable.numZones, writtenSectors, imageSectors);
+	struct CopyJob job = {0};
+	struct CopyExtent* extents = writtenExtents(&zoneTable, sectorSize, &job.numExtents);
+	job.extents = extents;
+	job.srcFd = devFd;
+	job.dstFd = imageFd;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	bool success = extents && runCopyJob(&job, numThreads);
+	double seconds = elapsedSeconds(&start);
+	free(extents);
+	close(devFd);
+	// Tail checksums of the imaged data let incrzones spot zones reset and refilled since this image
+	success = success && readTailCrcs(imageFd, &zoneTable, sectorSize);
+	if (fsync(imageFd) < 0 || close(imageFd) < 0){
+		perror("Error writing image");
+		success = false;
+	}
+
+	FILE* manifest = fopen(manifestFile, "w");
+	if (!manifest || !zoneTableSave(&zoneTable, sectorSize, manifest)){
+		perror("Error writing zone manifest");
+		success = false;
+	}
+	if (manifest){
+		fclose(manifest);
+	}
+	zoneTableFree(&zoneTable);
+	if (!success){
+		return 1;
+	}
+	printf("Done.  %lu bytes in %.2f s (%.1f MB/s)\n", job.bytesCopied, seconds, job.bytesCopied / seconds / 1e6);
+	return 0;
+}
+
+/// Write each zone's imaged range from imageFile back onto deviceFile, so every write pointer ends up where the
+/// manifest recorded it.
+int restoreDevice(char* deviceFile, char* imageFile, char* manifestFile, int numThreads, enum ZoneBackends backend){
+	uint32_t sectorSize;
+	struct ZoneTable imageTable;
+	FILE* manifest = fopen(manifestFile, "r");
+	if (!manifest){
+		perror("Error opening zone manifest");
+		return 1;
+	}
+	bool loaded = zoneTableLoad(&imageTable, &sectorSize, manifest);
+	fclose(manifest);
+	if (!loaded){
+		return 1;
+	}
+
+	struct ZoneDevice dev;
+	if (!zoneDevOpen(&dev, deviceFile, backend)){
+		zoneTableFree(&imageTable);
+		return 1;
+	}
+	struct ReportZonesHeader zoneHeader;
+	struct ZoneTable devTable;
+	if (!zoneTableReportAll(&dev, &devTable, &zoneHeader)){
+		fprintf(stderr, "Error: Could not retrieve zone layout of %s\n", deviceFile);
+		zoneDevClose(&dev);
+		zoneTableFree(&imageTable);
+		return 1;
+	}
+
+	// The image can only be restored onto an identical zone layout
+	if (dev.sectorSize != sectorSize || !zoneTableSameLayout(&devTable, &imageTable)){
+		fprintf(stderr, "Error: Zone layout of %s does not match the zone manifest\n", deviceFile);
+		zoneDevClose(&dev);
+		zoneTableFree(&devTable);
+		zoneTableFree(&imageTable);
+		return 1;
+	}
+
+	// Sequential zones must be empty so that writing the imaged range reproduces the write pointer
+	printf("Resetting non-empty sequential zones...\n");
+	for (uint32_t i=0; i<devTable.numZones; i++){
+		uint8_t condition = zoneTableCondition(&devTable, i);
+		if (zoneTableType(&devTable, i) != ZONETYPE_CMR && condition != ZONECOND_EMPTY && condition != ZONECOND_OFFLINE){
+			if (!zoneDevResetWritePointer(&dev, zoneTableStartLba(&devTable, i), false)){
+				zoneDevClose(&dev);
+				zoneTableFree(&devTable);
+				zoneTableFree(&imageTable);
+				return 1;
+			}
+		}
+	}
+	zoneTableFree(&devTable);
+
+	// Do not implicitly open more zones at once than the drive supports
+	if (zoneHeader.maxOpenSeqZones > 0 && (uint32_t)numThreads > zoneHeader.maxOpenSeqZones){
+		numThreads = zoneHeader.maxOpenSeqZones;
+	}
+
+	int devFd = open(deviceFile, O_WRONLY | O_DIRECT);
+	int imageFd = open(imageFile, O_RDONLY);
+	if (devFd < 0 || imageFd < 0){
+		perror("Error opening device or image");
+		zoneDevClose(&dev);
+		zoneTableFree(&imageTable);
+		return 1;
+	}
+
+	printf("Restoring %u zones...\n", imageTable.numZones);
+	struct CopyJob job = {0};
+	struct CopyExtent* extents = writtenExtents(&imageTable, sectorSize, &job.numExtents);
+	job.extents = extents;
+	job.srcFd = imageFd;
+	job.dstFd = devFd;
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	bool success = extents && runCopyJob(&job, numThreads);
+	free(extents);
+	if (fsync(devFd) < 0){
+		perror("Error flushing device");
+		success = false;
+	}
+	double seconds = elapsedSeconds(&start);
+	close(imageFd);
+	close(devFd);
+	if (!success){
+		zoneDevClose(&dev);
+		zoneTableFree(&imageTable);
+		return 1;
+	}
+
+	// Verify that the write pointers were reproduced
+	if (!zoneTableReportAll(&dev, &devTable, &zoneHeader)){
+		zoneDevClose(&dev);
+		zoneTableFree(&imageTable);
+		return 1;
+	}
+	zoneDevClose(&dev);
+	uint32_t mismatches = 0;
+	for (uint32_t i=0; i<imageTable.numZones; i++){
+		if (zoneTableType(&imageTable, i) != ZONETYPE_CMR
+			&& zoneTableWrittenLength(&devTable, i) != zoneTableWrittenLength(&imageTable, i)){
+			fprintf(stderr, "Warning: Write pointer of zone starting at LBA %#lx is %#lx, expected %#lx\n",
+				zoneTableStartLba(&imageTable, i), zoneTableWritePointer(&devTable, i), zoneTableWritePointer(&imageTable, i));
+			mismatches++;
+		}
+	}
+	zoneTableFree(&devTable);
+	zoneTableFree(&imageTable);
+	if (mismatches > 0){
+		fprintf(stderr, "Error: %u write pointers differ from the zone manifest\n", mismatches);
+		return 1;
+	}
+	printf("Done.  %lu bytes in %.2f s (%.1f MB/s)\n", job.bytesCopied, seconds, job.bytesCopied / seconds / 1e6);
+	return 0;
+}
+
+int main(int argc, char * argv[])
+{
+	int opt;
+	bool restore = false;
+	int numThreads = IMAGE_DEFAULT_THREADS;
+	char* manifestFile = NULL;
+	enum ZoneBackends backend = BACKEND_ATA;
+
+	while ((opt = getopt (argc, argv, "rj:m:k?")) != -1){
+		char* endPtr;
+		switch (opt){
+			case 'r':
+				restore = true;
+				break;
+			case 'j':
+				numThreads = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || numThreads <= 0 || numThreads > COPY_MAX_THREADS){
+					fprintf(stderr, "Invalid -j argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'm':
+				manifestFile = optarg;
+				break;
+			case 'k':
+				backend = BACKEND_BLK;
+				break;
+			case '?':
+				usage();
+				return 0;
+		}
+	}
+	if (optind + 1 >= argc){
+		printf("Requires device and image arguments.  Use -? for usage\n");
+		return 1;
+	}
+
+	char* deviceFile = argv[optind];
+	char* imageFile = argv[optind + 1];
+	char defaultManifest[4096];
+	if (!manifestFile){
+		snprintf(defaultManifest, sizeof(defaultManifest), "%s.manifest", imageFile);
+		manifestFile = defaultManifest;
+	}
+
+	if (restore){
+		return restoreDevice(deviceFile, imageFile, manifestFile, numThreads, backend);
+	}
+	return imageDevice(deviceFile, imageFile, manifestFile, numThreads, backend);
+}
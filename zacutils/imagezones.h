@@ -0,0 +1,14 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for write-pointer-aware zone imaging and restore tool
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_IMAGEZONES_H
+#define ZACUTILS_IMAGEZONES_H
+
+#include "zonetable.h"
+#include "zonecopy.h"
+
+#define IMAGE_DEFAULT_THREADS 4
+
+#endif
@@ -0,0 +1,365 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Incremental zone backup tool.  Sequential zones are append-only until reset, so only the range between the
+ * previous and the current write pointer is read.
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#include "incrzones.h"
+
+void usage(){
+	printf(	"Usage: incrzones [-?] [-j threads] [-o manifest] [-k] -b basemanifest dev archive\n"
+		"       incrzones [-?] [-j threads] -a image archive\n"
+		"	-?	: Print out usage\n"
+		"	-a	: Apply archive onto image (from imagezones) instead of backing up dev.  Optional.\n"
+		"	-b	: Zone manifest of the previous backup (from imagezones or incrzones).  Required unless -a.\n"
+		"	-j	: Number of parallel transfer threads (default: %d).  Optional.\n"
+		"	-o	: Zone manifest to write for the next backup (default: archive.manifest).  Optional.\n"
+		"	-k	: Use kernel zoned block device ioctls instead of ATA PASS-THROUGH.  Optional.\n"
+		"	dev	: The device handle to open (e.g. /dev/sdb).  Required.\n"
+		"	image	: Image file to update.  Required with -a.\n"
+		"	archive	: Incremental archive file to write, or to read with -a.  Required.\n",
+		INCR_DEFAULT_THREADS
+	);
+}
+
+/// Read the tail checksum of each written sequential zone of currTable from devFd, and flag in rewritten the zones
+/// whose data just before the base write pointer no longer matches the base tail checksum.  Those were reset and
+/// refilled to or past their previous write pointer, which the write pointers alone do not show.
+/// Returns success.
+bool checkZoneTails(int devFd, const struct ZoneTable* baseTable, struct ZoneTable* currTable, uint32_t sectorSize, uint8_t* rewritten){
+	if (!readTailCrcs(devFd, currTable, sectorSize)){
+		return false;
+	}
+	if (!baseTable->tailCrcs){
+		fprintf(stderr, "Warning: Base zone manifest has no tail checksums, so zones reset and refilled to or past their previous write pointer are treated as unchanged or appended to\n");
+		return true;
+	}
+	uint8_t* buff;
+	size_t buffLen = ZONE_TAIL_BYTES > sectorSize ? ZONE_TAIL_BYTES : sectorSize;
+	if (posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, buffLen) != 0){
+		fprintf(stderr, "Error: Could not allocate read buffer\n");
+		return false;
+	}
+	bool success = true;
+	for (uint32_t i=0; success && i<currTable->numZones; i++){
+		uint64_t prevLength = zoneTableWrittenLength(baseTable, i);
+		uint64_t currLength = zoneTableWrittenLength(currTable, i);
+		if (zoneTableType(currTable, i) == ZONETYPE_CMR || prevLength == 0 || currLength < prevLength){
+			continue;
+		}
+		uint32_t crc = zoneTableTailCrc(currTable, i);
+		if (currLength > prevLength){
+			success = readTailCrc(devFd, zoneTableStartLba(currTable, i), prevLength, sectorSize, buff, &crc);
+		}
+		rewritten[i] = success && crc != zoneTableTailCrc(baseTable, i);
+	}
+	free(buff);
+	return success;
+}
+
+/// Compare the base and current zone tables and describe the data written since the base in archive extent
+/// records and matching copy extents.  Data offsets are relative to the start of the extent data.  Zones flagged
+/// in rewritten are backed up whole.  Zones now offline cannot be read, so they are skipped with a warning.
+/// Returns the number of extents.
+uint32_t diffZoneTables(const struct ZoneTable* baseTable, const struct ZoneTable* currTable, uint32_t sectorSize,
+	const uint8_t* rewritten, struct IncrArchiveExtent* records, struct CopyExtent* extents){
+	uint32_t numExtents = 0;
+	uint64_t dataOffset = 0;
+	for (uint32_t i=0; i<currTable->numZones; i++){
+		uint64_t zoneStartLba = zoneTableStartLba(currTable, i);
+		if (zoneTableCondition(currTable, i) == ZONECOND_OFFLINE){
+			fprintf(stderr, "Warning: Skipping OFFLINE zone starting at LBA %#lx\n", zoneStartLba);
+			continue;
+		}
+		uint64_t prevLength = zoneTableWrittenLength(baseTable, i);
+		uint64_t currLength = zoneTableWrittenLength(currTable, i);
+		uint64_t startLba;
+		uint32_t flags;
+		if (zoneTableType(currTable, i) == ZONETYPE_CMR){
+			// No write pointer to compare against
+			startLba = zoneStartLba;
+			flags = INCR_EXTENT_CONVENTIONAL;
+		} else if (currLength < prevLength || rewritten[i]){
+			// Write pointer moved backwards, or the data before the previous write pointer changed, so the zone
+			// was reset (and possibly rewritten)
+			startLba = zoneStartLba;
+			flags = INCR_EXTENT_REWRITTEN;
+		} else if (currLength > prevLength){
+			startLba = zoneStartLba + prevLength;
+			flags = INCR_EXTENT_APPENDED;
+		} else {
+			continue;
+		}
+
+		struct IncrArchiveExtent* record = &records[numExtents];
+		memset(record, 0, sizeof(*record));
+		record->zoneStartLba = zoneStartLba;
+		record->startLba = startLba;
+		record->sectorCount = zoneStartLba + currLength - startLba;
+		record->dataOffset = dataOffset;
+		record->flags = flags;
+
+		extents[numExtents].srcOffset = startLba * sectorSize;
+		extents[numExtents].dstOffset = dataOffset;
+		extents[numExtents].length = record->sectorCount * sectorSize;
+		dataOffset += extents[numExtents].length;
+		numExtents++;
+	}
+	return numExtents;
+}
+
+/// Write the extent data of archiveFile into imageFile at each extent's LBA, bringing an image taken at the
+/// archive's base up to the time of the archive.  The archive's zone manifest then describes the image.
+/// Returns the exit status.
+int applyArchive(char* imageFile, char* archiveFile, int numThreads){
+	int archiveFd = open(archiveFile, O_RDONLY);
+	if (archiveFd < 0){
+		perror("Error opening archive");
+		return 1;
+	}
+	struct IncrArchiveHeader header;
+	off_t archiveSize = lseek(archiveFd, 0, SEEK_END);
+	if (archiveSize < 0 || pread(archiveFd, &header, sizeof(header), 0) != sizeof(header)
+		|| memcmp(header.magic, INCR_ARCHIVE_MAGIC, sizeof(header.magic)) != 0 || header.sectorSize == 0){
+		fprintf(stderr, "Error: %s is not an incremental archive\n", archiveFile);
+		close(archiveFd);
+		return 1;
+	}
+
+	size_t recordsLength = sizeof(struct IncrArchiveExtent) * (size_t)header.numExtents;
+	uint64_t dataStart = sizeof(header) + recordsLength;
+	struct IncrArchiveExtent* records = (struct IncrArchiveExtent*) malloc(recordsLength ? recordsLength : 1);
+	struct CopyExtent* extents = (struct CopyExtent*) malloc(sizeof(struct CopyExtent) * (header.numExtents ? header.numExtents : 1));
+	bool success = records && extents;
+	if (!success){
+		fprintf(stderr, "Error: Could not allocate extent list for %u extents\n", header.numExtents);
+	} else if ((uint64_t)archiveSize < dataStart + header.dataLength
+		|| pread(archiveFd, records, recordsLength, sizeof(header)) != (ssize_t)recordsLength){
+		fprintf(stderr, "Error: Archive %s is truncated\n", archiveFile);
+		success = false;
+	}
+	for (uint32_t i=0; success && i<header.numExtents; i++){
+		extents[i].srcOffset = records[i].dataOffset;
+		extents[i].dstOffset = records[i].startLba * header.sectorSize;
+		extents[i].length = records[i].sectorCount * header.sectorSize;
+		if (records[i].dataOffset < dataStart || records[i].sectorCount > header.dataLength / header.sectorSize
+			|| records[i].dataOffset + extents[i].length > dataStart + header.dataLength){
+			fprintf(stderr, "Error: Extent %u of archive %s lies outside its extent data\n", i, archiveFile);
+			success = false;
+		}
+	}
+	free(records);
+
+	int imageFd = -1;
+	if (success && (imageFd = open(imageFile, O_WRONLY)) < 0){
+		perror("Error opening image");
+		success = false;
+	}
+	struct CopyJob job = {0};
+	double seconds = 0;
+	if (success){
+		printf("Applying %u extents (%lu bytes) to %s...\n", header.numExtents, header.dataLength, imageFile);
+		job.extents = extents;
+		job.numExtents = header.numExtents;
+		job.srcFd = archiveFd;
+		job.dstFd = imageFd;
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		success = runCopyJob(&job, numThreads);
+		seconds = elapsedSeconds(&start);
+	}
+	free(extents);
+	close(archiveFd);
+	if (imageFd >= 0 && (fsync(imageFd) < 0 || close(imageFd) < 0)){
+		perror("Error writing image");
+		success = false;
+	}
+	if (!success){
+		return 1;
+	}
+	printf("Done.  %lu bytes in %.2f s (%.1f MB/s)\n", job.bytesCopied, seconds, seconds > 0 ? job.bytesCopied / seconds / 1e6 : 0);
+	return 0;
+}
+
+int main(int argc, char * argv[])
+{
+	int opt;
+	struct ZoneDevice dev;
+	enum ZoneBackends backend = BACKEND_ATA;
+	int numThreads = INCR_DEFAULT_THREADS;
+	char* baseManifestFile = NULL;
+	char* manifestFile = NULL;
+	bool apply = false;
+
+	while ((opt = getopt (argc, argv, "ab:j:o:k?")) != -1){
+		char* endPtr;
+		switch (opt){
+			case 'a':
+				apply = true;
+				break;
+			case 'b':
+				baseManifestFile = optarg;
+				break;
+			case 'j':
+				numThreads = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || numThreads <= 0 || numThreads > COPY_MAX_THREADS){
+					fprintf(stderr, "Invalid -j argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'o':
+				manifestFile = optarg;
+				break;
+			case 'k':
+				backend = BACKEND_BLK;
+				break;
+			case '?':
+				usage();
+				return 0;
+		}
+	}
+	if (apply){
+		if (optind + 1 >= argc){
+			printf("Requires image and archive arguments.  Use -? for usage\n");
+			return 1;
+		}
+		return applyArchive(argv[optind], argv[optind + 1], numThreads);
+	}
+	if (!baseManifestFile || optind + 1 >= argc){
+		printf("Requires -b, device and archive arguments.  Use -? for usage\n");
+		return 1;
+	}
+
+	char* deviceFile = argv[optind];
+	char* archiveFile = argv[optind + 1];
+	char defaultManifest[4096];
+	if (!manifestFile){
+		snprintf(defaultManifest, sizeof(defaultManifest), "%s.manifest", archiveFile);
+		manifestFile = defaultManifest;
+	}
+
+	uint32_t sectorSize;
+	struct ZoneTable baseTable;
+	FILE* manifest = fopen(baseManifestFile, "r");
+	if (!manifest){
+		perror("Error opening base zone manifest");
+		return 1;
+	}
+	bool loaded = zoneTableLoad(&baseTable, &sectorSize, manifest);
+	fclose(manifest);
+	if (!loaded){
+		return 1;
+	}
+
+	if (!zoneDevOpen(&dev, deviceFile, backend)){
+		zoneTableFree(&baseTable);
+		return 1;
+	}
+	struct ReportZonesHeader zoneHeader;
+	struct ZoneTable currTable;
+	if (!zoneTableReportAll(&dev, &currTable, &zoneHeader)){
+		fprintf(stderr, "Error: Could not retrieve zone layout of %s\n", deviceFile);
+		zoneDevClose(&dev);
+		zoneTableFree(&baseTable);
+		return 1;
+	}
+	zoneDevClose(&dev);
+	if (dev.sectorSize != sectorSize || !zoneTableSameLayout(&baseTable, &currTable)){
+		fprintf(stderr, "Error: Zone layout of %s does not match the base zone manifest\n", deviceFile);
+		zoneTableFree(&currTable);
+		zoneTableFree(&baseTable);
+		return 1;
+	}
+
+	uint32_t maxExtents = currTable.numZones ? currTable.numZones : 1;
+	struct IncrArchiveExtent* records = (struct IncrArchiveExtent*) malloc(sizeof(struct IncrArchiveExtent) * maxExtents);
+	struct CopyExtent* extents = (struct CopyExtent*) malloc(sizeof(struct CopyExtent) * maxExtents);
+	uint8_t* rewritten = (uint8_t*) calloc(maxExtents, 1);
+	int devFd = -1;
+	if (!records || !extents || !rewritten){
+		fprintf(stderr, "Error: Could not allocate extent list for %u zones\n", currTable.numZones);
+	} else if ((devFd = open(deviceFile, O_RDONLY | O_DIRECT)) < 0){
+		perror("Error opening device");
+	}
+	if (devFd < 0 || !checkZoneTails(devFd, &baseTable, &currTable, sectorSize, rewritten)){
+		if (devFd >= 0){
+			close(devFd);
+		}
+		free(records);
+		free(extents);
+		free(rewritten);
+		zoneTableFree(&currTable);
+		zoneTableFree(&baseTable);
+		return 1;
+	}
+
+	// Extent data follows the extent records, whose number is only known after the diff
+	uint32_t numExtents = diffZoneTables(&baseTable, &currTable, sectorSize, rewritten, records, extents);
+	free(rewritten);
+	uint64_t dataStart = sizeof(struct IncrArchiveHeader) + sizeof(struct IncrArchiveExtent) * (uint64_t)numExtents;
+	uint64_t dataLength = 0;
+	for (uint32_t i=0; i<numExtents; i++){
+		records[i].dataOffset += dataStart;
+		extents[i].dstOffset += dataStart;
+		dataLength += extents[i].length;
+	}
+	zoneTableFree(&baseTable);
+
+	struct IncrArchiveHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INCR_ARCHIVE_MAGIC, sizeof(header.magic));
+	header.sectorSize = sectorSize;
+	header.numExtents = numExtents;
+	header.dataLength = dataLength;
+
+	bool success = true;
+	int archiveFd = open(archiveFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	size_t recordsLength = sizeof(struct IncrArchiveExtent) * numExtents;
+	if (archiveFd < 0
+		|| pwrite(archiveFd, &header, sizeof(header), 0) != sizeof(header)
+		|| pwrite(archiveFd, records, recordsLength, sizeof(header)) != (ssize_t)recordsLength){
+		perror("Error writing archive");
+		success = false;
+	}
+	free(records);
+
+	struct CopyJob job = {0};
+	double seconds = 0;
+	if (success){
+		printf("Backing up %u extents (%lu bytes) since %s...\n", numExtents, dataLength, baseManifestFile);
+		job.extents = extents;
+		job.numExtents = numExtents;
+		job.srcFd = devFd;
+		job.dstFd = archiveFd;
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		success = runCopyJob(&job, numThreads);
+		seconds = elapsedSeconds(&start);
+	}
+	free(extents);
+	if (devFd >= 0){
+		close(devFd);
+	}
+	if (archiveFd >= 0 && (fsync(archiveFd) < 0 || close(archiveFd) < 0)){
+		perror("Error writing archive");
+		success = false;
+	}
+
+	// The current zone table is the base of the next incremental backup
+	if (success){
+		manifest = fopen(manifestFile, "w");
+		if (!manifest || !zoneTableSave(&currTable, sectorSize, manifest)){
+			perror("Error writing zone manifest");
+			success = false;
+		}
+		if (manifest){
+			fclose(manifest);
+		}
+	}
+	zoneTableFree(&currTable);
+	if (!success){
+		return 1;
+	}
+	printf("Done.  %lu bytes in %.2f s (%.1f MB/s)\n", job.bytesCopied, seconds, seconds > 0 ? job.bytesCopied / seconds / 1e6 : 0);
+	return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for write-pointer-based incremental zone backup tool
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_INCRZONES_H
+#define ZACUTILS_INCRZONES_H
+
+#include "zonetable.h"
+#include "zonecopy.h"
+
+#define INCR_DEFAULT_THREADS 4
+
+/// First 8 bytes of an incremental archive
+#define INCR_ARCHIVE_MAGIC "ZACINCR1"
+
+/// Incremental archive header (64 bytes).  It is followed by numExtents extent records, then the extent data.
+struct IncrArchiveHeader {
+	char magic[8];
+	uint32_t sectorSize;
+	uint32_t numExtents;
+	uint64_t dataLength;		// Total bytes of extent data
+	uint8_t _reserved[40];
+};
+
+/// Incremental archive extent record (40 bytes)
+struct IncrArchiveExtent {
+	uint64_t zoneStartLba;
+	uint64_t startLba;		// First LBA of the extent's data
+	uint64_t sectorCount;
+	uint64_t dataOffset;		// Byte offset of the extent's data within the archive
+	uint32_t flags;
+	uint8_t _reserved[4];
+};
+
+/// Incremental archive extent flags
+enum IncrExtentFlags {
+	INCR_EXTENT_APPENDED = 0x0,	// Data written past the previous write pointer
+	INCR_EXTENT_REWRITTEN = 0x1,	// Zone was reset since the previous backup; extent holds all of its data
+	INCR_EXTENT_CONVENTIONAL = 0x2	// Zone has no write pointer (CMR); extent holds the whole zone
+};
+
+#endif
@@ -4,6 +4,8 @@
  * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
  * Author: Austin Liou (austin.liou@wdc.com)
  */
+#ifndef ZACUTILS_REPORTZONES_H
+#define ZACUTILS_REPORTZONES_H
 
 #include "common.h"
 
@@ -58,7 +60,9 @@ enum ZoneConditions {
 	ZONECOND_EMPTY = 0x1,		// ZC1 Empty state
 	ZONECOND_IMP_OPEN = 0x2,	// ZC2 Implicit Open state
 	ZONECOND_CLOSED = 0x4,		// ZC4 Closed state
-	ZONECOND_FULL = 0xe		// ZC5 Full state
+	ZONECOND_RDONLY = 0xd,		// ZC6 Read Only state
+	ZONECOND_FULL = 0xe,		// ZC5 Full state
+	ZONECOND_OFFLINE = 0xf		// ZC7 Offline state
 };
 
 /// Reporting Options (for filtering which zones to report)
@@ -74,3 +78,5 @@ enum ReportingOptions {
 	ROPT_RESET = 0x10,	// Zones with RESET bit set
 	ROPT_NOWP = 0x3f	// Zones with no write pointer (e.g. CMR)
 };
+
+#endif
@@ -4,6 +4,9 @@
  * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
  * Author: Austin Liou (austin.liou@wdc.com)
  */
+#ifndef ZACUTILS_RESETZONES_H
+#define ZACUTILS_RESETZONES_H
+
 #include "common.h"
 
 #define RESET_ALL_BIT (1<<8)
@@ -12,3 +15,5 @@
 enum ZoneMgmtActions {
 	ACTION_RESET_WRITE_POINTER = 0x04
 };
+
+#endif
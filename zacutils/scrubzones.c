@@ -0,0 +1,539 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Zone scrub tool.  Reads only the written range of each zone (up to the write pointer) with several reads in
+ * flight, computes CRC32C checksums per zone and per block, and writes them to or compares them with a manifest.
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#include <errno.h>
+#include "scrubzones.h"
+
+void usage(){
+	printf(	"Usage: scrubzones [-?] [-j threads] [-b blockkib] [-r mbps] [-o manifest | -c manifest] [-k] dev\n"
+		"	-?	: Print out usage\n"
+		"	-j	: Number of reads in flight, one per thread (default: %d).  Optional.\n"
+		"	-b	: Size of each checksummed block, in KiB (default: %d; with -c, taken from the manifest).  Optional.\n"
+		"	-r	: Limit reads to this many MB/s (default: no limit).  Optional.\n"
+		"	-o	: Write checksums to this scrub manifest.  Optional.\n"
+		"	-c	: Compare checksums with this scrub manifest.  Optional.\n"
+		"	-k	: Use kernel zoned block device ioctls instead of ATA PASS-THROUGH.  Optional.\n"
+		"	dev	: The device handle to open (e.g. /dev/sdb).  Required.\n",
+		SCRUB_DEFAULT_THREADS, SCRUB_DEFAULT_BLOCK_KIB
+	);
+}
+
+/// Bytes in block j of zone
+static inline uint64_t scrubBlockLength(const struct ScrubResult* result, const struct ScrubZone* zone, uint32_t j){
+	uint64_t remaining = zone->writtenSectors * result->sectorSize - (uint64_t)j * result->blockSize;
+	return remaining < result->blockSize ? remaining : result->blockSize;
+}
+
+void freeResult(struct ScrubResult* result){
+	free(result->zones);
+	free(result->blockCrcs);
+	result->zones = NULL;
+	result->blockCrcs = NULL;
+}
+
+/// List the written range of each zone in table.  EMPTY zones are skipped, and counted in numSkipped.  OFFLINE zones
+/// are listed with nothing to read, and READ ONLY zones (which have no write pointer) are read whole; both are
+/// reported and counted in numDegraded.  Returns success.
+bool listZones(const struct ZoneTable* table, struct ScrubResult* result, uint64_t chunkSize, uint64_t* numChunks, uint32_t* numSkipped, uint32_t* numDegraded){
+	result->zones = (struct ScrubZone*) malloc(sizeof(struct ScrubZone) * (table->numZones ? table->numZones : 1));
+	if (!result->zones){
+		fprintf(stderr, "Error: Could not allocate zone list for %u zones\n", table->numZones);
+		return false;
+	}
+	result->numZones = 0;
+	result->numBlocks = 0;
+	*numChunks = 0;
+	*numSkipped = 0;
+	*numDegraded = 0;
+	for (uint32_t i=0; i<table->numZones; i++){
+		uint8_t condition = zoneTableCondition(table, i);
+		uint64_t writtenSectors = zoneTableWrittenLength(table, i);
+		if (condition == ZONECOND_OFFLINE || condition == ZONECOND_RDONLY){
+			fprintf(stderr, "Error: Zone %#lx is %s\n", zoneTableStartLba(table, i), condition == ZONECOND_OFFLINE ? "OFFLINE" : "READ ONLY");
+			(*numDegraded)++;
+		} else if (condition == ZONECOND_EMPTY || writtenSectors == 0){
+			(*numSkipped)++;
+			continue;
+		}
+		uint64_t writtenBytes = writtenSectors * result->sectorSize;
+		struct ScrubZone* zone = &result->zones[result->numZones++];
+		zone->startLba = zoneTableStartLba(table, i);
+		zone->writtenSectors = writtenSectors;
+		zone->firstBlock = result->numBlocks;
+		zone->firstChunk = *numChunks;
+		zone->numBlocks = (writtenBytes + result->blockSize - 1) / result->blockSize;
+		zone->crc = 0;
+		zone->condition = condition;
+		result->numBlocks += zone->numBlocks;
+		*numChunks += (writtenBytes + chunkSize - 1) / chunkSize;
+	}
+	result->blockCrcs = (uint32_t*) calloc(result->numBlocks ? result->numBlocks : 1, sizeof(uint32_t));
+	if (!result->blockCrcs){
+		fprintf(stderr, "Error: Could not allocate checksums for %lu blocks\n", result->numBlocks);
+		return false;
+	}
+	return true;
+}
+
+/// Index of the zone holding chunk
+static uint32_t chunkZone(const struct ScrubJob* job, uint64_t chunk){
+	uint32_t low = 0;
+	uint32_t high = job->numZones - 1;
+	while (low < high){
+		uint32_t mid = low + (high - low + 1) / 2;
+		if (job->zones[mid].firstChunk <= chunk){
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	return low;
+}
+
+/// Scrub thread.  Read errors are recorded against the zone, and scrubbing goes on.
+static void* scrubWorker(void* arg){
+	struct ScrubJob* job = (struct ScrubJob*)arg;
+	uint8_t* buff;
+	if (posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, job->chunkSize) != 0){
+		fprintf(stderr, "Error: Could not allocate read buffer\n");
+		job->failed = true;
+		return NULL;
+	}
+	uint64_t i;
+	while (!job->failed && (i = __sync_fetch_and_add(&job->nextChunk, 1)) < job->numChunks){
+		uint32_t z = chunkZone(job, i);
+		const struct ScrubZone* zone = &job->zones[z];
+		uint64_t offset = (i - zone->firstChunk) * job->chunkSize;
+		uint64_t writtenBytes = zone->writtenSectors * job->sectorSize;
+		size_t len = writtenBytes - offset < job->chunkSize ? writtenBytes - offset : job->chunkSize;
+
+		if (job->rate > 0){
+			// Start each read no earlier than the limit allows for the bytes issued before it
+			uint64_t issued = __sync_fetch_and_add(&job->bytesIssued, len);
+			double delay = issued / job->rate - elapsedSeconds(&job->start);
+			if (delay > 0){
+				struct timespec ts = { (time_t)delay, (long)((delay - (time_t)delay) * 1e9) };
+				nanosleep(&ts, NULL);
+			}
+		}
+
+		uint64_t byteOffset = zone->startLba * job->sectorSize + offset;
+		size_t done = 0;
+		while (done < len){
+			ssize_t ret = pread(job->fd, buff + done, len - done, byteOffset + done);
+			if (ret <= 0){
+				fprintf(
+					stderr,
+					"Error: Read failed in zone %#lx at LBA %#lx: %s\n",
+					zone->startLba,
+					(byteOffset + done) / job->sectorSize,
+					ret < 0 ? strerror(errno) : "end of device"
+				);
+				job->readErrors[z] = 1;
+				break;
+			}
+			done += ret;
+		}
+		if (done < len){
+			continue;
+		}
+		uint32_t* blockCrcs = &job->blockCrcs[zone->firstBlock + offset / job->blockSize];
+		for (size_t blockOffset = 0; blockOffset < len; blockOffset += job->blockSize){
+			size_t blockLen = len - blockOffset < job->blockSize ? len - blockOffset : job->blockSize;
+			*blockCrcs++ = crc32c(0, buff + blockOffset, blockLen);
+		}
+		__sync_fetch_and_add(&job->bytesRead, len);
+	}
+	free(buff);
+	return NULL;
+}
+
+/// Run numThreads scrub threads over every chunk in job.  Returns success (read errors aside).
+bool runScrubJob(struct ScrubJob* job, int numThreads){
+	pthread_t threads[COPY_MAX_THREADS];
+	int started = 0;
+	for (; started<numThreads; started++){
+		if (pthread_create(&threads[started], NULL, scrubWorker, job) != 0){
+			fprintf(stderr, "Error: Could not start scrub thread\n");
+			job->failed = true;
+			break;
+		}
+	}
+	for (int i=0; i<started; i++){
+		pthread_join(threads[i], NULL);
+	}
+	return !job->failed;
+}
+
+/// Fold the block checksums of each zone into its zone checksum
+void combineZoneCrcs(struct ScrubResult* result){
+	uint32_t blockOp = crc32cShiftOp(result->blockSize);
+	for (uint32_t i=0; i<result->numZones; i++){
+		struct ScrubZone* zone = &result->zones[i];
+		const uint32_t* blockCrcs = &result->blockCrcs[zone->firstBlock];
+		if (zone->numBlocks == 0){
+			continue;	// OFFLINE
+		}
+		uint32_t crc = blockCrcs[0];
+		for (uint32_t j=1; j<zone->numBlocks; j++){
+			uint64_t len = scrubBlockLength(result, zone, j);
+			crc = crc32cCombineOp(crc, blockCrcs[j], len == result->blockSize ? blockOp : crc32cShiftOp(len));
+		}
+		zone->crc = crc;
+	}
+}
+
+/// Write the checksums of the zones read without errors to file as a CSV scrub manifest.  OFFLINE zones are left
+/// out.  Returns success.
+bool saveManifest(const struct ScrubResult* result, const uint8_t* readErrors, FILE* file){
+	uint32_t numZones = 0;
+	for (uint32_t i=0; i<result->numZones; i++){
+		numZones += !readErrors[i] && result->zones[i].condition != ZONECOND_OFFLINE;
+	}
+	fprintf(file, "%s\n", SCRUB_MANIFEST_MAGIC);
+	fprintf(file, "Sector Size,Block Size,Number of Zones\n");
+	fprintf(file, "%u,%u,%u\n", result->sectorSize, result->blockSize, numZones);
+	fprintf(file, "Zone Start LBA,Written Sectors,Zone CRC32C,Block CRC32C...\n");
+	for (uint32_t i=0; i<result->numZones; i++){
+		const struct ScrubZone* zone = &result->zones[i];
+		if (readErrors[i] || zone->condition == ZONECOND_OFFLINE){
+			continue;
+		}
+		fprintf(file, "%#lx,%#lx,%#x", zone->startLba, zone->writtenSectors, zone->crc);
+		for (uint32_t j=0; j<zone->numBlocks; j++){
+			fprintf(file, ",%#x", result->blockCrcs[zone->firstBlock + j]);
+		}
+		fputc('\n', file);
+	}
+	fflush(file);
+	return !ferror(file);
+}
+
+/// Read a CSV scrub manifest written by saveManifest.  Returns success.
+bool loadManifest(struct ScrubResult* result, FILE* file){
+	char* line = NULL;
+	size_t lineCapacity = 0;
+	uint64_t blockCapacity = 1024;
+	memset(result, 0, sizeof(*result));
+	bool success = getline(&line, &lineCapacity, file) > 0
+		&& strncmp(line, SCRUB_MANIFEST_MAGIC, strlen(SCRUB_MANIFEST_MAGIC)) == 0
+		&& getline(&line, &lineCapacity, file) > 0
+		&& getline(&line, &lineCapacity, file) > 0
+		&& sscanf(line, "%u,%u,%u", &result->sectorSize, &result->blockSize, &result->numZones) == 3
+		&& result->sectorSize > 0
+		&& result->blockSize > 0
+		&& getline(&line, &lineCapacity, file) > 0;
+	if (success){
+		result->zones = (struct ScrubZone*) malloc(sizeof(struct ScrubZone) * (result->numZones ? result->numZones : 1));
+		result->blockCrcs = (uint32_t*) malloc(sizeof(uint32_t) * blockCapacity);
+		if (!result->zones || !result->blockCrcs){
+			fprintf(stderr, "Error: Could not allocate scrub manifest for %u zones\n", result->numZones);
+			free(line);
+			freeResult(result);
+			return false;
+		}
+	}
+	for (uint32_t i=0; success && i<result->numZones; i++){
+		struct ScrubZone* zone = &result->zones[i];
+		char* ptr;
+		if (getline(&line, &lineCapacity, file) <= 0){
+			success = false;
+			break;
+		}
+		zone->startLba = strtoull(line, &ptr, 0);
+		success = *ptr == ',';
+		zone->writtenSectors = success ? strtoull(ptr + 1, &ptr, 0) : 0;
+		success = success && *ptr == ',';
+		zone->crc = success ? strtoul(ptr + 1, &ptr, 0) : 0;
+		zone->firstBlock = result->numBlocks;
+		zone->numBlocks = 0;
+		zone->condition = ZONECOND_NO_WP;
+		while (success && *ptr == ','){
+			if (result->numBlocks == blockCapacity){
+				uint32_t* blockCrcs = (uint32_t*) realloc(result->blockCrcs, sizeof(uint32_t) * blockCapacity * 2);
+				if (!blockCrcs){
+					fprintf(stderr, "Error: Could not allocate scrub manifest checksums\n");
+					success = false;
+					break;
+				}
+				result->blockCrcs = blockCrcs;
+				blockCapacity *= 2;
+			}
+			result->blockCrcs[result->numBlocks++] = strtoul(ptr + 1, &ptr, 0);
+			zone->numBlocks++;
+		}
+		success = success && (*ptr == '\n' || *ptr == '\0')
+			&& zone->numBlocks == (zone->writtenSectors * result->sectorSize + result->blockSize - 1) / result->blockSize;
+	}
+	free(line);
+	if (!success){
+		fprintf(stderr, "Error: Invalid scrub manifest\n");
+		freeResult(result);
+	}
+	return success;
+}
+
+/// Compare the scrubbed checksums with those of a manifest.  Sequential zones only grow until reset, so blocks of
+/// equal length in both are compared; a zone whose written range shrank was reset and is not compared.  A zone of
+/// the manifest that is now OFFLINE counts as one mismatch, since its data can no longer be read.
+/// Returns the number of mismatched blocks.
+uint64_t compareResults(const struct ScrubResult* manifest, const struct ScrubResult* result, const uint8_t* readErrors){
+	uint64_t mismatches = 0;
+	uint32_t numReset = 0;
+	uint32_t numAppended = 0;
+	uint32_t numNew = 0;
+	uint32_t numSkipped = 0;
+	uint32_t numOffline = 0;
+	uint32_t i = 0;
+	uint32_t j = 0;
+	while (i < manifest->numZones || j < result->numZones){
+		const struct ScrubZone* oldZone = i < manifest->numZones ? &manifest->zones[i] : NULL;
+		const struct ScrubZone* newZone = j < result->numZones ? &result->zones[j] : NULL;
+		if (!newZone || (oldZone && oldZone->startLba < newZone->startLba)){
+			// Not scrubbed because it is now empty
+			printf("Reset: zone %#lx is empty\n", oldZone->startLba);
+			numReset++;
+			i++;
+			continue;
+		}
+		if (!oldZone || newZone->startLba < oldZone->startLba){
+			numNew++;
+			j++;
+			continue;
+		}
+		i++;
+		j++;
+		if (newZone->condition == ZONECOND_OFFLINE){
+			printf("Offline: zone %#lx, %#lx sectors in the manifest\n", newZone->startLba, oldZone->writtenSectors);
+			numOffline++;
+			continue;
+		}
+		if (readErrors[j-1]){
+			numSkipped++;
+			continue;
+		}
+		if (newZone->writtenSectors < oldZone->writtenSectors){
+			printf("Reset: zone %#lx write pointer moved back\n", newZone->startLba);
+			numReset++;
+			continue;
+		}
+		numAppended += newZone->writtenSectors > oldZone->writtenSectors;
+		uint32_t numBlocks = oldZone->numBlocks < newZone->numBlocks ? oldZone->numBlocks : newZone->numBlocks;
+		uint32_t zoneMismatches = 0;
+		for (uint32_t k=0; k<numBlocks; k++){
+			uint64_t len = scrubBlockLength(result, newZone, k);
+			if (len != scrubBlockLength(manifest, oldZone, k)){
+				continue;	// Last block of the manifest, since appended to
+			}
+			if (manifest->blockCrcs[oldZone->firstBlock + k] != result->blockCrcs[newZone->firstBlock + k]){
+				printf(
+					"Mismatch: zone %#lx, LBA %#lx, %lu bytes\n",
+					newZone->startLba,
+					newZone->startLba + (uint64_t)k * result->blockSize / result->sectorSize,
+					len
+				);
+				zoneMismatches++;
+			}
+		}
+		if (zoneMismatches == 0 && newZone->writtenSectors == oldZone->writtenSectors && newZone->crc != oldZone->crc){
+			printf("Mismatch: zone %#lx checksum\n", newZone->startLba);
+			zoneMismatches++;
+		}
+		mismatches += zoneMismatches;
+	}
+	printf(
+		"Compared with manifest: %lu mismatched blocks, %u zones offline, %u zones reset, %u zones appended to, %u new zones, %u zones not compared\n",
+		mismatches,
+		numOffline,
+		numReset,
+		numAppended,
+		numNew,
+		numSkipped
+	);
+	return mismatches + numOffline;
+}
+
+int main(int argc, char * argv[])
+{
+	int opt;
+	struct ZoneDevice dev;
+	enum ZoneBackends backend = BACKEND_ATA;
+	int numThreads = SCRUB_DEFAULT_THREADS;
+	int32_t blockKib = SCRUB_DEFAULT_BLOCK_KIB;
+	double rateMbps = 0;
+	char* manifestFile = NULL;
+	char* compareFile = NULL;
+
+	while ((opt = getopt (argc, argv, "j:b:r:o:c:k?")) != -1){
+		char* endPtr;
+		switch (opt){
+			case 'j':
+				numThreads = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || numThreads <= 0 || numThreads > COPY_MAX_THREADS){
+					fprintf(stderr, "Invalid -j argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'b':
+				blockKib = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || blockKib <= 0 || blockKib > (COPY_CHUNK_SIZE >> 10)){
+					fprintf(stderr, "Invalid -b argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'r':
+				rateMbps = strtod(optarg,&endPtr);
+				if (*endPtr!='\0' || rateMbps <= 0){
+					fprintf(stderr, "Invalid -r argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'o':
+				manifestFile = optarg;
+				break;
+			case 'c':
+				compareFile = optarg;
+				break;
+			case 'k':
+				backend = BACKEND_BLK;
+				break;
+			case '?':
+				usage();
+				return 0;
+		}
+	}
+	if (optind >= argc){
+		printf("Requires device argument.  Use -? for usage\n");
+		return 1;
+	}
+	if (manifestFile && compareFile){
+		fprintf(stderr, "Use either -o or -c.  Use -? for usage.\n");
+		return 1;
+	}
+
+	struct ScrubResult manifest = {0};
+	if (compareFile){
+		FILE* file = fopen(compareFile, "r");
+		if (!file){
+			perror("Error opening scrub manifest");
+			return 1;
+		}
+		bool loaded = loadManifest(&manifest, file);
+		fclose(file);
+		if (!loaded){
+			return 1;
+		}
+	}
+
+	char* deviceFile = argv[optind];
+	if (!zoneDevOpen(&dev, deviceFile, backend)){
+		freeResult(&manifest);
+		return 1;
+	}
+	struct ReportZonesHeader zoneHeader;
+	struct ZoneTable table;
+	if (!zoneTableReportAll(&dev, &table, &zoneHeader)){
+		zoneDevClose(&dev);
+		freeResult(&manifest);
+		return 1;
+	}
+	zoneDevClose(&dev);
+
+	struct ScrubResult result = {0};
+	result.sectorSize = dev.sectorSize;
+	result.blockSize = compareFile ? manifest.blockSize : (uint32_t)blockKib << 10;
+	if (compareFile && manifest.sectorSize != result.sectorSize){
+		fprintf(stderr, "Error: Sector size of %s does not match the scrub manifest\n", deviceFile);
+		zoneTableFree(&table);
+		freeResult(&manifest);
+		return 1;
+	}
+	if (result.blockSize % result.sectorSize != 0 || result.blockSize > COPY_CHUNK_SIZE){
+		fprintf(stderr, "Error: Block size must be a multiple of the %u-byte sector size, up to %u bytes\n", result.sectorSize, COPY_CHUNK_SIZE);
+		zoneTableFree(&table);
+		freeResult(&manifest);
+		return 1;
+	}
+
+	struct ScrubJob job = {0};
+	uint32_t numSkipped;
+	uint32_t numDegraded;
+	job.chunkSize = (uint64_t)result.blockSize * (COPY_CHUNK_SIZE / result.blockSize);
+	bool success = listZones(&table, &result, job.chunkSize, &job.numChunks, &numSkipped, &numDegraded);
+	zoneTableFree(&table);
+	job.readErrors = (uint8_t*) calloc(result.numZones ? result.numZones : 1, 1);
+	if (!success || !job.readErrors){
+		fprintf(stderr, "Error: Could not allocate zone list\n");
+		free(job.readErrors);
+		freeResult(&result);
+		freeResult(&manifest);
+		return 1;
+	}
+	if ((job.fd = open(deviceFile, O_RDONLY | O_DIRECT)) < 0){
+		perror("Error opening device");
+		free(job.readErrors);
+		freeResult(&result);
+		freeResult(&manifest);
+		return 1;
+	}
+
+	uint64_t totalBytes = 0;
+	for (uint32_t i=0; i<result.numZones; i++){
+		totalBytes += result.zones[i].writtenSectors * result.sectorSize;
+	}
+	printf(
+		"Scrubbing %u zones (%lu bytes; %u empty zones skipped) with %d reads in flight, CRC32C in %s...\n",
+		result.numZones,
+		totalBytes,
+		numSkipped,
+		numThreads,
+		crc32cHardware() ? "hardware" : "software"
+	);
+	fflush(stdout);
+	job.sectorSize = result.sectorSize;
+	job.blockSize = result.blockSize;
+	job.zones = result.zones;
+	job.numZones = result.numZones;
+	job.blockCrcs = result.blockCrcs;
+	job.rate = rateMbps * 1e6;
+	clock_gettime(CLOCK_MONOTONIC, &job.start);
+	success = runScrubJob(&job, numThreads);
+	double seconds = elapsedSeconds(&job.start);
+	close(job.fd);
+
+	uint32_t numReadErrors = 0;
+	for (uint32_t i=0; i<result.numZones; i++){
+		numReadErrors += job.readErrors[i];
+	}
+	if (success){
+		combineZoneCrcs(&result);
+		printf(
+			"Done.  %lu bytes in %.2f s (%.1f MB/s), %u zones with read errors, %u zones OFFLINE or READ ONLY\n",
+			job.bytesRead,
+			seconds,
+			seconds > 0 ? job.bytesRead / seconds / 1e6 : 0,
+			numReadErrors,
+			numDegraded
+		);
+	}
+	if (success && manifestFile){
+		FILE* file = fopen(manifestFile, "w");
+		if (!file || !saveManifest(&result, job.readErrors, file)){
+			perror("Error writing scrub manifest");
+			success = false;
+		}
+		if (file){
+			fclose(file);
+		}
+	}
+	if (success && compareFile){
+		success = compareResults(&manifest, &result, job.readErrors) == 0;
+	}
+	free(job.readErrors);
+	freeResult(&result);
+	freeResult(&manifest);
+	return success && numReadErrors == 0 && numDegraded == 0 ? 0 : 1;
+}
@@ -0,0 +1,60 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for written-range zone scrub tool
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_SCRUBZONES_H
+#define ZACUTILS_SCRUBZONES_H
+
+#include "zonetable.h"
+#include "zonecopy.h"
+#include "crc32c.h"
+
+#define SCRUB_DEFAULT_THREADS 4
+#define SCRUB_DEFAULT_BLOCK_KIB 1024
+
+/// First line of a scrub manifest
+#define SCRUB_MANIFEST_MAGIC "zacutils scrub manifest,1"
+
+/// Written range of a zone and its checksums
+struct ScrubZone {
+	uint64_t startLba;
+	uint64_t writtenSectors;
+	uint64_t firstBlock;		// Index of the zone's first block checksum
+	uint64_t firstChunk;		// Index of the zone's first chunk among all zones' chunks
+	uint32_t numBlocks;
+	uint32_t crc;			// CRC32C of the whole written range
+	uint8_t condition;		// Zone condition when scrubbed (ZONECOND_NO_WP for manifest zones)
+};
+
+/// Work shared by the scrub threads.  Each thread claims the next chunk (chunkSize bytes of a zone, the last one
+/// possibly shorter), reads it and checksums its blocks.
+struct ScrubJob {
+	int fd;
+	uint32_t sectorSize;
+	uint32_t blockSize;
+	uint64_t chunkSize;		// Multiple of blockSize
+	const struct ScrubZone* zones;
+	uint32_t numZones;
+	uint64_t numChunks;
+	uint32_t* blockCrcs;
+	uint8_t* readErrors;		// Per zone, set if any read in it failed
+	double rate;			// Bytes per second, 0 for no limit
+	struct timespec start;
+	volatile uint64_t nextChunk;
+	volatile uint64_t bytesIssued;
+	volatile uint64_t bytesRead;
+	volatile bool failed;
+};
+
+/// Scrub results or manifest contents
+struct ScrubResult {
+	uint32_t sectorSize;
+	uint32_t blockSize;
+	struct ScrubZone* zones;
+	uint32_t numZones;
+	uint32_t* blockCrcs;
+	uint64_t numBlocks;
+};
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Format a device as a staged volume (writes logged in CMR zones, destaged to sequential zones), or recover one:
+ * replay its log, destage everything and print its state.  A test pattern can be written and verified across
+ * a recovery.
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#include "stagezones.h"
+
+void usage(){
+	printf(	"Usage: stagezones [-?] [-f] [-b blocksize] [-n numzones] [-w passes | -v passes] [-k] dev\n"
+		"	-?	: Print out usage\n"
+		"	-f	: Format dev as an empty staged volume.  DESTROYS ALL DATA ON THE DEVICE.  Optional.\n"
+		"		  Without -f, the staged volume on dev is recovered and its log destaged.\n"
+		"	-b	: Volume block size in bytes, with -f (default: %d).  Optional.\n"
+		"	-n	: Number of sequential zones to use, with -f (default: all).  Optional.\n"
+		"	-w	: Write a test pattern over the whole volume passes times and verify it, then exit without destaging,\n"
+		"		  as after a crash.  DESTROYS THE DATA OF THE VOLUME.  Optional.\n"
+		"	-v	: Verify the test pattern of -w passes after recovering the volume.  Optional.\n"
+		"	-k	: Use kernel zoned block device ioctls instead of ATA PASS-THROUGH.  Optional.\n"
+		"	dev	: The device handle to open (e.g. /dev/sdb).  Required.\n",
+		STAGE_DEFAULT_BLOCK_SIZE
+	);
+}
+
+void printLayout(const struct StageSuperblock* sb){
+	printf("Volume:      %lu blocks of %u bytes\n", sb->numBlocks, sb->blockSize);
+	printf("Log:         %lu blocks at LBA %#lx\n", sb->logBlocks, sb->logLba);
+	printf("Checkpoints: %u map blocks each at LBA %#lx and %#lx\n", sb->mapBlocks, sb->checkpointLba[0], sb->checkpointLba[1]);
+	printf("Data zones:  %u from LBA %#lx (%u reserved)\n", sb->numDataZones, sb->dataLba, sb->reserveZones);
+}
+
+/// Fill count blocks at logical block with the test pattern of pass
+void fillPattern(uint64_t* buff, uint64_t volumeId, uint64_t block, uint32_t count, uint32_t blockSize, int32_t pass){
+	uint64_t words = (uint64_t)count * blockSize / sizeof(uint64_t);
+	uint64_t first = block * (blockSize / sizeof(uint64_t));
+	for (uint64_t w = 0; w < words; w++){
+		buff[w] = volumeId ^ ((uint64_t)pass << 48) ^ (first + w);
+	}
+}
+
+/// Write the test pattern over the whole volume passes times, in runs of varying length so that records are split
+/// and the log wraps, then make it durable.  Returns success.
+bool writePattern(struct ZoneStage* stage, int32_t passes){
+	uint32_t blockSize = stage->sb.blockSize;
+	uint32_t maxRun = 2 * STAGE_MAX_RECORD_BLOCKS;
+	uint64_t* buff;
+	if (posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, (size_t)maxRun * blockSize) != 0){
+		fprintf(stderr, "Error: Could not allocate pattern buffer\n");
+		return false;
+	}
+	bool success = true;
+	for (int32_t pass = 0; success && pass < passes; pass++){
+		for (uint64_t block = 0; success && block < stage->sb.numBlocks; ){
+			uint32_t run = 1 + (block * 7 + pass * 13) % maxRun;
+			run = stage->sb.numBlocks - block < run ? stage->sb.numBlocks - block : run;
+			fillPattern(buff, stage->sb.volumeId, block, run, blockSize, pass);
+			success = stageWrite(stage, block, (uint8_t*)buff, run);
+			block += run;
+		}
+	}
+	free(buff);
+	return success && stageSync(stage);
+}
+
+/// Read the whole volume back and compare it with the test pattern of pass.  Returns whether it matches.
+bool verifyPattern(struct ZoneStage* stage, int32_t pass){
+	uint32_t blockSize = stage->sb.blockSize;
+	uint64_t* buff;
+	uint64_t* expected = (uint64_t*) malloc((size_t)STAGE_MOVE_BLOCKS * blockSize);
+	if (posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, (size_t)STAGE_MOVE_BLOCKS * blockSize) != 0 || !expected){
+		fprintf(stderr, "Error: Could not allocate verify buffer\n");
+		free(expected);
+		return false;
+	}
+	uint64_t mismatches = 0;
+	bool success = true;
+	for (uint64_t block = 0; success && block < stage->sb.numBlocks; block += STAGE_MOVE_BLOCKS){
+		uint32_t count = stage->sb.numBlocks - block < STAGE_MOVE_BLOCKS ? stage->sb.numBlocks - block : STAGE_MOVE_BLOCKS;
+		success = stageRead(stage, block, (uint8_t*)buff, count);
+		fillPattern(expected, stage->sb.volumeId, block, count, blockSize, pass);
+		for (uint32_t i = 0; success && i < count; i++){
+			if (memcmp((uint8_t*)buff + (size_t)i * blockSize, (uint8_t*)expected + (size_t)i * blockSize, blockSize) != 0){
+				if (mismatches++ < 10){
+					fprintf(stderr, "Error: Block %#lx does not match the test pattern\n", block + i);
+				}
+			}
+		}
+	}
+	free(buff);
+	free(expected);
+	if (mismatches > 0){
+		fprintf(stderr, "Error: %lu blocks do not match the test pattern\n", mismatches);
+	}
+	return success && mismatches == 0;
+}
+
+int main(int argc, char * argv[])
+{
+	int opt;
+	enum ZoneBackends backend = BACKEND_ATA;
+	bool format = false;
+	int32_t blockSize = STAGE_DEFAULT_BLOCK_SIZE;
+	int32_t numZones = 0;
+	int32_t passes = 0;
+	bool write = false;
+
+	while ((opt = getopt (argc, argv, "fb:n:w:v:k?")) != -1){
+		char* endPtr;
+		switch (opt){
+			case 'f':
+				format = true;
+				break;
+			case 'b':
+				blockSize = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || blockSize <= 0){
+					fprintf(stderr, "Invalid -b argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'n':
+				numZones = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || numZones <= 0){
+					fprintf(stderr, "Invalid -n argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'w':
+			case 'v':
+				passes = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || passes <= 0){
+					fprintf(stderr, "Invalid -%c argument.  Use -? for usage.\n", opt);
+					return 1;
+				}
+				write = opt == 'w';
+				break;
+			case 'k':
+				backend = BACKEND_BLK;
+				break;
+			case '?':
+				usage();
+				return 0;
+		}
+	}
+	if (optind >= argc){
+		printf("Requires device argument.  Use -? for usage\n");
+		return 1;
+	}
+
+	char* deviceFile = argv[optind];
+	if (format){
+		struct StageSuperblock sb;
+		if (!stageFormat(deviceFile, backend, blockSize, numZones, &sb)){
+			return 1;
+		}
+		printLayout(&sb);
+		return 0;
+	}
+
+	struct ZoneStage stage;
+	if (!stageOpen(&stage, deviceFile, backend)){
+		return 1;
+	}
+	printLayout(&stage.sb);
+	printf("Replayed:    %lu log records\n", stage.recordsReplayed);
+	if (write){
+		// The log is left for the next open to replay, like after a crash
+		bool success = writePattern(&stage, passes) && verifyPattern(&stage, passes - 1);
+		printf("Pattern:     %d passes of %lu blocks written, %s\n", passes, stage.sb.numBlocks, success ? "verified" : "FAILED");
+		return success ? 0 : 1;
+	}
+	bool success = true;
+	if (passes > 0){
+		success = verifyPattern(&stage, passes - 1);
+		printf("Pattern:     %s\n", success ? "verified" : "FAILED");
+	}
+	success = stageFlush(&stage) && success;
+	printf("Destaged:    %lu blocks, %lu blocks relocated, %lu zones reset\n", stage.blocksDestaged, stage.blocksRelocated, stage.zonesReset);
+	printf("Free zones:  %u\n", stageFreeZones(&stage));
+	success = stageClose(&stage) && success;
+	return success ? 0 : 1;
+}
@@ -0,0 +1,11 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for the staged volume format and recovery tool
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_STAGEZONES_H
+#define ZACUTILS_STAGEZONES_H
+
+#include "zonestage.h"
+
+#endif
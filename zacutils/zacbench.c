@@ -0,0 +1,402 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Device-level benchmark of REPORT ZONES DMA and RESET WRITE POINTER latency, and of sequential write throughput
+ * into one or more concurrently open zones.  Results are printed in CSV format.
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#include "zacbench.h"
+
+void usage(){
+	printf(	"Usage: zacbench [-?] [-i iterations] [-p maxpages] [-w] [-W] [-z maxzones] [-s zonemib] [-b blockkib] [-k] dev\n"
+		"	-?	: Print out usage\n"
+		"	-i	: Iterations of each REPORT ZONES DMA and reset-all measurement (default: %d).  Optional.\n"
+		"	-p	: Largest REPORT ZONES DMA transfer, in 512-byte pages (default: %d).  Optional.\n"
+		"	-w	: Run sequential write and single zone reset tests.  Only zones reported EMPTY are written,\n"
+		"		  and they are reset afterwards.  Optional.\n"
+		"	-W	: Also measure resetting ALL zones.  DESTROYS ALL DATA ON THE DEVICE.  Optional.\n"
+		"	-z	: Largest number of concurrently written zones (default: max. open seq. zones).  Optional.\n"
+		"	-s	: MiB written to each zone (default: %d, at most the zone length).  Optional.\n"
+		"	-b	: Size of each write, in KiB (default: %d).  Optional.\n"
+		"	-k	: Use kernel zoned block device ioctls instead of ATA PASS-THROUGH.  Optional.\n"
+		"	dev	: The device handle to open (e.g. /dev/sdb).  Required.\n",
+		BENCH_DEFAULT_ITERATIONS, BENCH_DEFAULT_MAX_PAGES, BENCH_DEFAULT_ZONE_MIB, BENCH_DEFAULT_BLOCK_KIB
+	);
+}
+
+bool samplesInit(struct BenchSamples* samples, uint32_t capacity){
+	samples->count = 0;
+	samples->capacity = capacity ? capacity : 1;
+	samples->us = (double*) malloc(sizeof(double) * samples->capacity);
+	if (!samples->us){
+		fprintf(stderr, "Error: Could not allocate %u latency samples\n", capacity);
+		return false;
+	}
+	return true;
+}
+
+/// Record the time elapsed since start.  Samples beyond the capacity are dropped.
+void samplesAdd(struct BenchSamples* samples, struct timespec* start){
+	if (samples->count < samples->capacity){
+		samples->us[samples->count++] = elapsedSeconds(start) * 1e6;
+	}
+}
+
+int compareDoubles(const void* a, const void* b){
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+/// Nearest-rank percentile of sorted samples
+double percentile(const struct BenchSamples* samples, double pct){
+	uint32_t rank = (uint32_t)(pct / 100.0 * samples->count + 0.999999);
+	rank = rank == 0 ? 1 : rank;
+	return samples->us[(rank > samples->count ? samples->count : rank) - 1];
+}
+
+void printCsvHeader(){
+	printf("Test,Parameter,Samples,Min (us),Mean (us),P50 (us),P90 (us),P99 (us),P99.9 (us),Max (us),Rate,Rate Unit\n");
+}
+
+/// Print one CSV row of latency statistics, followed by rate (e.g. zones/s or MB/s)
+void printCsvRow(const char* test, const char* parameter, struct BenchSamples* samples, double rate, const char* rateUnit){
+	if (samples->count == 0){
+		printf("%s,%s,0,,,,,,,,%.1f,%s\n", test, parameter, rate, rateUnit);
+		return;
+	}
+	double sum = 0;
+	for (uint32_t i=0; i<samples->count; i++){
+		sum += samples->us[i];
+	}
+	qsort(samples->us, samples->count, sizeof(double), compareDoubles);
+	printf(
+		"%s,%s,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%s\n",
+		test,
+		parameter,
+		samples->count,
+		samples->us[0],
+		sum / samples->count,
+		percentile(samples, 50),
+		percentile(samples, 90),
+		percentile(samples, 99),
+		percentile(samples, 99.9),
+		samples->us[samples->count-1],
+		rate,
+		rateUnit
+	);
+	fflush(stdout);
+}
+
+/// Measure REPORT ZONES DMA latency and zones/s for transfers of 1, 2, 4, ... maxPages pages.  Each iteration
+/// starts at a different zone.  Returns success.
+bool benchReportZones(struct ZoneDevice* dev, const struct ZoneTable* table, uint32_t iterations, uint32_t maxPages){
+	uint8_t* dataBuff = (uint8_t*) malloc(maxPages * 512);
+	struct BenchSamples samples;
+	if (!dataBuff || !samplesInit(&samples, iterations)){
+		fprintf(stderr, "Error: Could not allocate REPORT ZONES DMA buffer\n");
+		free(dataBuff);
+		return false;
+	}
+	bool success = true;
+	for (uint32_t pages = 1; success; pages *= 2){
+		pages = pages < maxPages ? pages : maxPages;
+		uint32_t maxEntries = (pages*512 - sizeof(struct ReportZonesHeader)) / sizeof(struct ReportZonesEntry);
+		uint64_t zonesReported = 0;
+		double seconds = 0;
+		samples.count = 0;
+		for (uint32_t i=0; i<iterations; i++){
+			uint64_t lba = zoneTableStartLba(table, (uint32_t)(((uint64_t)i * 7919) % table->numZones));
+			struct timespec start;
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			if (!zoneDevReportZones(dev, lba, ROPT_ALL, dataBuff, pages*512)){
+				success = false;
+				break;
+			}
+			samplesAdd(&samples, &start);
+			seconds += samples.us[samples.count-1] / 1e6;
+			uint32_t numRecords = (*(struct ReportZonesHeader*)dataBuff).zoneListLength / sizeof(struct ReportZonesEntry);
+			zonesReported += numRecords < maxEntries ? numRecords : maxEntries;
+		}
+		char parameter[32];
+		snprintf(parameter, sizeof(parameter), "pages=%u", pages);
+		printCsvRow("report_zones", parameter, &samples, seconds > 0 ? zonesReported / seconds : 0, "zones/s");
+		if (pages == maxPages){
+			break;
+		}
+	}
+	free(samples.us);
+	free(dataBuff);
+	return success;
+}
+
+/// Writer thread: sequential writes of blockSize, timing each one
+void* benchWriter(void* arg){
+	struct BenchWriter* writer = (struct BenchWriter*)arg;
+	uint8_t* buff;
+	if (posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, writer->blockSize) != 0){
+		fprintf(stderr, "Error: Could not allocate write buffer\n");
+		writer->failed = true;
+		return NULL;
+	}
+	memset(buff, 0xa5, writer->blockSize);
+	for (uint64_t done = 0; done < writer->length; done += writer->blockSize){
+		size_t len = writer->length - done > writer->blockSize ? writer->blockSize : writer->length - done;
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (pwrite(writer->fd, buff, len, writer->offset + done) != (ssize_t)len){
+			perror("Write error");
+			writer->failed = true;
+			break;
+		}
+		samplesAdd(&writer->samples, &start);
+		writer->bytesWritten += len;
+	}
+	free(buff);
+	return NULL;
+}
+
+/// Measure sequential write throughput into 1, 2, 4, ... maxZones concurrently open empty zones, each written by
+/// its own thread.  The written zones are reset afterwards, and those resets are timed as single zone resets.
+/// Returns success.
+bool benchSequentialWrites(struct ZoneDevice* dev, const char* deviceFile, const struct ZoneTable* table,
+	uint32_t maxZones, uint64_t zoneBytes, size_t blockSize){
+	uint32_t emptyZones[BENCH_MAX_WRITERS];
+	uint32_t numEmpty = 0;
+	for (uint32_t i=0; i<table->numZones && numEmpty < maxZones; i++){
+		if (zoneTableType(table, i) != ZONETYPE_CMR && zoneTableCondition(table, i) == ZONECOND_EMPTY){
+			emptyZones[numEmpty++] = i;
+		}
+	}
+	if (numEmpty == 0){
+		fprintf(stderr, "Warning: No empty sequential zones, skipping write tests\n");
+		return true;
+	}
+	if (numEmpty < maxZones){
+		fprintf(stderr, "Warning: Only %u empty sequential zones, testing up to %u open zones\n", numEmpty, numEmpty);
+		maxZones = numEmpty;
+	}
+
+	int fd = open(deviceFile, O_WRONLY | O_DIRECT);
+	if (fd < 0){
+		perror("Error opening device for writing");
+		return false;
+	}
+
+	struct BenchWriter writers[BENCH_MAX_WRITERS];
+	pthread_t threads[BENCH_MAX_WRITERS];
+	// Every round resets the zones it wrote: 1 + 2 + 4 + ... + maxZones
+	uint32_t totalResets = 0;
+	for (uint32_t numZones = 1; ; numZones *= 2){
+		numZones = numZones < maxZones ? numZones : maxZones;
+		totalResets += numZones;
+		if (numZones == maxZones){
+			break;
+		}
+	}
+	struct BenchSamples resetSamples;
+	if (!samplesInit(&resetSamples, totalResets)){
+		close(fd);
+		return false;
+	}
+	bool success = true;
+	double resetSeconds = 0;
+	for (uint32_t numZones = 1; success; numZones *= 2){
+		numZones = numZones < maxZones ? numZones : maxZones;
+		struct BenchSamples samples;
+		uint32_t started = 0;
+		uint64_t blocksPerZone = (zoneBytes + blockSize - 1) / blockSize;
+		if (!samplesInit(&samples, blocksPerZone * numZones)){
+			success = false;
+			break;
+		}
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (; started<numZones; started++){
+			struct BenchWriter* writer = &writers[started];
+			uint32_t zone = emptyZones[started];
+			uint64_t length = zoneTableLength(table, zone) * dev->sectorSize;
+			writer->fd = fd;
+			writer->offset = zoneTableStartLba(table, zone) * dev->sectorSize;
+			writer->length = zoneBytes < length ? zoneBytes : length;
+			writer->blockSize = blockSize;
+			writer->bytesWritten = 0;
+			writer->failed = false;
+			if (!samplesInit(&writer->samples, blocksPerZone)){
+				break;
+			}
+			if (pthread_create(&threads[started], NULL, benchWriter, writer) != 0){
+				fprintf(stderr, "Error: Could not start writer thread\n");
+				free(writer->samples.us);
+				break;
+			}
+		}
+		uint64_t bytesWritten = 0;
+		for (uint32_t i=0; i<started; i++){
+			pthread_join(threads[i], NULL);
+			success = success && !writers[i].failed;
+			for (uint32_t j=0; j<writers[i].samples.count; j++){
+				samples.us[samples.count++] = writers[i].samples.us[j];
+			}
+			bytesWritten += writers[i].bytesWritten;
+			free(writers[i].samples.us);
+		}
+		double seconds = elapsedSeconds(&start);
+		success = success && started == numZones;
+
+		char parameter[32];
+		snprintf(parameter, sizeof(parameter), "zones=%u", numZones);
+		printCsvRow("seq_write", parameter, &samples, seconds > 0 ? bytesWritten / seconds / 1e6 : 0, "MB/s");
+		free(samples.us);
+
+		// Reset the written zones so they are empty for the next round
+		for (uint32_t i=0; i<numZones; i++){
+			struct timespec resetStart;
+			clock_gettime(CLOCK_MONOTONIC, &resetStart);
+			if (!zoneDevResetWritePointer(dev, zoneTableStartLba(table, emptyZones[i]), false)){
+				success = false;
+				break;
+			}
+			samplesAdd(&resetSamples, &resetStart);
+			resetSeconds += elapsedSeconds(&resetStart);
+		}
+		if (numZones == maxZones){
+			break;
+		}
+	}
+	close(fd);
+	if (success){
+		printCsvRow("reset_zone", "written", &resetSamples, resetSeconds > 0 ? resetSamples.count / resetSeconds : 0, "zones/s");
+	}
+	free(resetSamples.us);
+	return success;
+}
+
+/// Measure RESET WRITE POINTER with the ALL bit set.  Returns success.
+bool benchResetAll(struct ZoneDevice* dev, const struct ZoneTable* table, uint32_t iterations){
+	struct BenchSamples samples;
+	if (!samplesInit(&samples, iterations)){
+		return false;
+	}
+	double seconds = 0;
+	bool success = true;
+	for (uint32_t i=0; i<iterations; i++){
+		struct timespec start;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		if (!zoneDevResetWritePointer(dev, 0, true)){
+			success = false;
+			break;
+		}
+		samplesAdd(&samples, &start);
+		seconds += samples.us[samples.count-1] / 1e6;
+	}
+	printCsvRow("reset_all", "all", &samples, seconds > 0 ? samples.count * (double)table->numZones / seconds : 0, "zones/s");
+	free(samples.us);
+	return success;
+}
+
+int main(int argc, char * argv[])
+{
+	int opt;
+	struct ZoneDevice dev;
+	enum ZoneBackends backend = BACKEND_ATA;
+	int32_t iterations = BENCH_DEFAULT_ITERATIONS;
+	int32_t maxPages = BENCH_DEFAULT_MAX_PAGES;
+	int32_t maxZones = 0;
+	int32_t zoneMib = BENCH_DEFAULT_ZONE_MIB;
+	int32_t blockKib = BENCH_DEFAULT_BLOCK_KIB;
+	bool writeTests = false;
+	bool resetAllTest = false;
+
+	while ((opt = getopt (argc, argv, "i:p:wWz:s:b:k?")) != -1){
+		char* endPtr;
+		switch (opt){
+			case 'i':
+				iterations = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || iterations <= 0){
+					fprintf(stderr, "Invalid -i argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'p':
+				maxPages = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || maxPages <= 0 || maxPages > 0xFFFF){	// 16-bit page count
+					fprintf(stderr, "Invalid -p argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'w':
+				writeTests = true;
+				break;
+			case 'W':
+				resetAllTest = true;
+				break;
+			case 'z':
+				maxZones = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || maxZones <= 0 || maxZones > BENCH_MAX_WRITERS){
+					fprintf(stderr, "Invalid -z argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 's':
+				zoneMib = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || zoneMib <= 0){
+					fprintf(stderr, "Invalid -s argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'b':
+				blockKib = strtol(optarg,&endPtr,0);
+				if (*endPtr!='\0' || blockKib <= 0 || blockKib > 0x10000){
+					fprintf(stderr, "Invalid -b argument.  Use -? for usage.\n");
+					return 1;
+				}
+				break;
+			case 'k':
+				backend = BACKEND_BLK;
+				break;
+			case '?':
+				usage();
+				return 0;
+		}
+	}
+	if (optind >= argc){
+		printf("Requires device argument.  Use -? for usage\n");
+		return 1;
+	}
+
+	char* deviceFile = argv[optind];
+	if (!zoneDevOpen(&dev, deviceFile, backend)){
+		return 1;
+	}
+	struct ReportZonesHeader zoneHeader;
+	struct ZoneTable zoneTable;
+	if (!zoneTableReportAll(&dev, &zoneTable, &zoneHeader)){
+		zoneDevClose(&dev);
+		return 1;
+	}
+	if (zoneTable.numZones == 0){
+		fprintf(stderr, "Error: Device reported 0 zones\n");
+		zoneTableFree(&zoneTable);
+		zoneDevClose(&dev);
+		return 1;
+	}
+	if (maxZones == 0){
+		if (zoneHeader.maxOpenSeqZones == 0 || zoneHeader.maxOpenSeqZones == 0xFFFFFFFF){	// Not reported
+			maxZones = BENCH_DEFAULT_MAX_OPEN;
+		} else {
+			maxZones = zoneHeader.maxOpenSeqZones < BENCH_MAX_WRITERS ? zoneHeader.maxOpenSeqZones : BENCH_MAX_WRITERS;
+		}
+	}
+
+	printCsvHeader();
+	bool success = benchReportZones(&dev, &zoneTable, iterations, maxPages);
+	if (success && writeTests){
+		success = benchSequentialWrites(&dev, deviceFile, &zoneTable, maxZones, (uint64_t)zoneMib << 20, (size_t)blockKib << 10);
+	}
+	if (success && resetAllTest){
+		success = benchResetAll(&dev, &zoneTable, iterations);
+	}
+	zoneTableFree(&zoneTable);
+	zoneDevClose(&dev);
+	return success ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for device-level benchmark of zone command latency and sequential zone throughput
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_ZACBENCH_H
+#define ZACUTILS_ZACBENCH_H
+
+#include "zonetable.h"
+#include "zonecopy.h"
+
+#define BENCH_DEFAULT_ITERATIONS 100
+
+/// Largest REPORT ZONES DMA transfer benchmarked by default, in 512-byte pages (same as the tools' buffer)
+#define BENCH_DEFAULT_MAX_PAGES 256
+
+/// Default amount written to each zone in the sequential write test, in MiB
+#define BENCH_DEFAULT_ZONE_MIB 64
+
+/// Default size of each sequential write, in KiB
+#define BENCH_DEFAULT_BLOCK_KIB 1024
+
+/// Concurrently open zones tested when the drive does not report a maximum
+#define BENCH_DEFAULT_MAX_OPEN 8
+
+#define BENCH_MAX_WRITERS 128
+
+/// Latency samples of one benchmark, in microseconds
+struct BenchSamples {
+	double* us;
+	uint32_t count;
+	uint32_t capacity;
+};
+
+/// One sequential writer thread, filling [offset, offset+length) of a zone
+struct BenchWriter {
+	int fd;
+	uint64_t offset;
+	uint64_t length;
+	size_t blockSize;
+	uint64_t bytesWritten;
+	struct BenchSamples samples;
+	bool failed;
+};
+
+#endif
@@ -0,0 +1,131 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Parallel O_DIRECT extent copying shared by the zone imaging tools
+ */
+#include "zonecopy.h"
+
+/// Transfer len bytes from srcOffset in srcFd to dstOffset in dstFd through buff, retrying short transfers.
+/// Returns success.
+bool copyRange(int srcFd, uint64_t srcOffset, int dstFd, uint64_t dstOffset, uint8_t* buff, size_t len){
+	size_t done = 0;
+	while (done < len){
+		ssize_t ret = pread(srcFd, buff + done, len - done, srcOffset + done);
+		if (ret <= 0){
+			perror("Read error");
+			return false;
+		}
+		done += ret;
+	}
+	done = 0;
+	while (done < len){
+		ssize_t ret = pwrite(dstFd, buff + done, len - done, dstOffset + done);
+		if (ret <= 0){
+			perror("Write error");
+			return false;
+		}
+		done += ret;
+	}
+	return true;
+}
+
+/// Copy thread.  Extents are copied front to back in COPY_CHUNK_SIZE transfers.
+static void* copyWorker(void* arg){
+	struct CopyJob* job = (struct CopyJob*)arg;
+	uint8_t* buff;
+	if (posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, COPY_CHUNK_SIZE) != 0){
+		fprintf(stderr, "Error: Could not allocate transfer buffer\n");
+		job->failed = true;
+		return NULL;
+	}
+	uint32_t i;
+	while (!job->failed && (i = __sync_fetch_and_add(&job->nextExtent, 1)) < job->numExtents){
+		const struct CopyExtent* extent = &job->extents[i];
+		for (uint64_t done = 0; done < extent->length; ){
+			size_t len = extent->length - done > COPY_CHUNK_SIZE ? COPY_CHUNK_SIZE : extent->length - done;
+			if (!copyRange(job->srcFd, extent->srcOffset + done, job->dstFd, extent->dstOffset + done, buff, len)){
+				fprintf(stderr, "Error: Transfer failed at byte offset %#lx\n", extent->srcOffset + done);
+				job->failed = true;
+				break;
+			}
+			__sync_fetch_and_add(&job->bytesCopied, len);
+			done += len;
+		}
+	}
+	free(buff);
+	return NULL;
+}
+
+/// Run numThreads copy threads over every extent in job.  Returns success.
+bool runCopyJob(struct CopyJob* job, int numThreads){
+	pthread_t threads[COPY_MAX_THREADS];
+	int started = 0;
+	if (numThreads > COPY_MAX_THREADS){
+		numThreads = COPY_MAX_THREADS;
+	}
+	for (; started<numThreads; started++){
+		if (pthread_create(&threads[started], NULL, copyWorker, job) != 0){
+			fprintf(stderr, "Error: Could not start transfer thread\n");
+			job->failed = true;
+			break;
+		}
+	}
+	for (int i=0; i<started; i++){
+		pthread_join(threads[i], NULL);
+	}
+	return !job->failed;
+}
+
+/// Compute the CRC32C of the last ZONE_TAIL_BYTES (at least one sector) of the first writtenSectors of the zone at
+/// zoneStartLba into crc.  buff must hold that many bytes, aligned for O_DIRECT.  Returns success.
+bool readTailCrc(int fd, uint64_t zoneStartLba, uint64_t writtenSectors, uint32_t sectorSize, uint8_t* buff, uint32_t* crc){
+	uint64_t tailSectors = ZONE_TAIL_BYTES > sectorSize ? ZONE_TAIL_BYTES / sectorSize : 1;
+	if (tailSectors > writtenSectors){
+		tailSectors = writtenSectors;
+	}
+	size_t len = tailSectors * sectorSize;
+	uint64_t offset = (zoneStartLba + writtenSectors - tailSectors) * sectorSize;
+	size_t done = 0;
+	while (done < len){
+		ssize_t ret = pread(fd, buff + done, len - done, offset + done);
+		if (ret <= 0){
+			perror("Read error");
+			fprintf(stderr, "Error: Could not read the tail of the zone starting at LBA %#lx\n", zoneStartLba);
+			return false;
+		}
+		done += ret;
+	}
+	*crc = crc32c(0, buff, len);
+	return true;
+}
+
+/// Fill in the tail checksum of every written sequential zone in table from fd, in LBA order.  CMR and offline
+/// zones, and zones with nothing written, get 0.  Returns success.
+bool readTailCrcs(int fd, struct ZoneTable* table, uint32_t sectorSize){
+	uint8_t* buff;
+	size_t buffLen = ZONE_TAIL_BYTES > sectorSize ? ZONE_TAIL_BYTES : sectorSize;
+	if (!zoneTableInitTailCrcs(table)){
+		return false;
+	}
+	if (posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, buffLen) != 0){
+		fprintf(stderr, "Error: Could not allocate read buffer\n");
+		return false;
+	}
+	bool success = true;
+	for (uint32_t i=0; success && i<table->numZones; i++){
+		uint64_t writtenSectors = zoneTableWrittenLength(table, i);
+		table->tailCrcs[i] = 0;
+		if (zoneTableType(table, i) == ZONETYPE_CMR || writtenSectors == 0){
+			continue;
+		}
+		success = readTailCrc(fd, zoneTableStartLba(table, i), writtenSectors, sectorSize, buff, &table->tailCrcs[i]);
+	}
+	free(buff);
+	return success;
+}
+
+/// Seconds elapsed since start (CLOCK_MONOTONIC)
+double elapsedSeconds(struct timespec* start){
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) + (end.tv_nsec - start->tv_nsec) / 1e9;
+}
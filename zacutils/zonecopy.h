@@ -0,0 +1,46 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for parallel O_DIRECT extent copying shared by the zone imaging tools
+ */
+#ifndef ZACUTILS_ZONECOPY_H
+#define ZACUTILS_ZONECOPY_H
+
+#include <pthread.h>
+#include <time.h>
+#include "zonetable.h"
+#include "crc32c.h"
+
+/// Size of each O_DIRECT transfer, in bytes
+#define COPY_CHUNK_SIZE (4<<20)
+
+/// Alignment of O_DIRECT transfer buffers, in bytes
+#define COPY_BUFFER_ALIGN 4096
+
+#define COPY_MAX_THREADS 64
+
+/// Byte range to copy.  An extent is always copied front to back by a single thread, so writes into a
+/// sequential zone stay sequential.
+struct CopyExtent {
+	uint64_t srcOffset;
+	uint64_t dstOffset;
+	uint64_t length;
+};
+
+/// Work shared by the copy threads.  Each thread claims the next extent and copies it.
+struct CopyJob {
+	const struct CopyExtent* extents;
+	uint32_t numExtents;
+	int srcFd;
+	int dstFd;
+	volatile uint32_t nextExtent;
+	volatile uint64_t bytesCopied;
+	volatile bool failed;
+};
+
+bool copyRange(int srcFd, uint64_t srcOffset, int dstFd, uint64_t dstOffset, uint8_t* buff, size_t len);
+bool runCopyJob(struct CopyJob* job, int numThreads);
+bool readTailCrc(int fd, uint64_t zoneStartLba, uint64_t writtenSectors, uint32_t sectorSize, uint8_t* buff, uint32_t* crc);
+bool readTailCrcs(int fd, struct ZoneTable* table, uint32_t sectorSize);
+double elapsedSeconds(struct timespec* start);
+
+#endif
@@ -0,0 +1,414 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Zoned device access through either ATA PASS-THROUGH or the kernel zoned block layer.  Zones reported by the
+ * kernel are mapped into the REPORT ZONES DMA layout so both backends share the same parsing.
+ */
+#include <sys/sysmacros.h>
+#include "zonedev.h"
+
+/// Read the kernel's maximum number of open zones of the device behind fd from sysfs.  Returns 0 if unknown.
+static uint32_t blkMaxOpenZones(int fd){
+	struct stat st;
+	char path[64];
+	unsigned int maxOpenZones = 0;
+	if (fstat(fd, &st) < 0){
+		return 0;
+	}
+	snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/queue/max_open_zones", major(st.st_rdev), minor(st.st_rdev));
+	FILE* file = fopen(path, "r");
+	if (!file){
+		return 0;
+	}
+	if (fscanf(file, "%u", &maxOpenZones) != 1){
+		maxOpenZones = 0;
+	}
+	fclose(file);
+	return maxOpenZones;
+}
+
+/// Open deviceFile for zone commands through the given backend.  Returns success.
+bool zoneDevOpen(struct ZoneDevice* dev, const char* deviceFile, enum ZoneBackends backend){
+	memset(dev, 0, sizeof(*dev));
+	dev->backend = backend;
+	if ((dev->fd = open(deviceFile, O_RDWR)) < 0) {
+		perror("Error opening device");
+		return false;
+	}
+	if (ioctl(dev->fd, BLKSSZGET, &dev->sectorSize) < 0){
+		dev->sectorSize = 512;	// e.g. an sg character device, which only supports BACKEND_ATA
+	}
+	if (backend != BACKEND_BLK){
+		return true;
+	}
+
+	uint32_t zoneSectors = 0;
+	uint64_t capacityBytes = 0;
+	if (ioctl(dev->fd, BLKGETNRZONES, &dev->numZones) < 0 || dev->numZones == 0
+		|| ioctl(dev->fd, BLKGETZONESZ, &zoneSectors) < 0 || zoneSectors == 0
+		|| ioctl(dev->fd, BLKGETSIZE64, &capacityBytes) < 0){
+		fprintf(stderr, "Error: %s is not a zoned block device\n", deviceFile);
+		zoneDevClose(dev);
+		return false;
+	}
+	dev->zoneSectors = zoneSectors;
+	dev->capacitySectors = capacityBytes >> BLK_SECTOR_SHIFT;
+	while ((512u << dev->lbaShift) < dev->sectorSize){
+		dev->lbaShift++;
+	}
+	dev->maxOpenZones = blkMaxOpenZones(dev->fd);
+	return true;
+}
+
+void zoneDevClose(struct ZoneDevice* dev){
+	if (dev->fd >= 0){
+		close(dev->fd);
+	}
+	dev->fd = -1;
+}
+
+/// Returns whether a kernel zone descriptor matches the REPORT ZONES DMA reporting options
+bool zoneDevBlkZoneMatches(const struct blk_zone* zone, uint8_t reportingOptions){
+	switch (reportingOptions){
+		case ROPT_ALL:
+			return true;
+		case ROPT_EMPTY:
+			return zone->cond == BLK_ZONE_COND_EMPTY;
+		case ROPT_IMPOPEN:
+			return zone->cond == BLK_ZONE_COND_IMP_OPEN;
+		case ROPT_EXPOPEN:
+			return zone->cond == BLK_ZONE_COND_EXP_OPEN;
+		case ROPT_CLOSED:
+			return zone->cond == BLK_ZONE_COND_CLOSED;
+		case ROPT_FULL:
+			return zone->cond == BLK_ZONE_COND_FULL;
+		case ROPT_RDONLY:
+			return zone->cond == BLK_ZONE_COND_READONLY;
+		case ROPT_OFFLINE:
+			return zone->cond == BLK_ZONE_COND_OFFLINE;
+		case ROPT_RESET:
+			return zone->reset;
+		case ROPT_NOWP:
+			return zone->cond == BLK_ZONE_COND_NOT_WP;
+		default:
+			return false;
+	}
+}
+
+/// Map a kernel zone descriptor into a REPORT ZONES DMA record
+void zoneDevBlkZoneToEntry(const struct ZoneDevice* dev, const struct blk_zone* zone, struct ReportZonesEntry* entry){
+	memset(entry, 0, sizeof(*entry));
+	// Kernel zone types and conditions use the ZAC/ZBC values
+	entry->options = (zone->type & 0xF) | ((zone->reset & 0x1) << 8) | ((zone->cond & 0xF) << 12);
+	entry->zoneLength = zone->len >> dev->lbaShift;
+	entry->zoneStartLba = zone->start >> dev->lbaShift;
+	if (zone->cond == BLK_ZONE_COND_NOT_WP){
+		entry->writePointer = UINT64_MAX;	// No write pointer
+	} else {
+		entry->writePointer = zone->wp >> dev->lbaShift;
+	}
+}
+
+/// BLKREPORTZONE equivalent of REPORT ZONES DMA.  Zones not matching reportingOptions are filtered out here.
+/// The walk stops once buff is full, so the zone list length then only counts the matches seen so far, unless
+/// countAll is set, in which case every remaining zone is walked to count them all.
+static bool blkReportZones(struct ZoneDevice* dev, uint64_t lba, uint8_t reportingOptions, uint8_t* buff, unsigned int buffLen, bool countAll){
+	memset(buff, 0, buffLen);
+	struct ReportZonesHeader* header = (struct ReportZonesHeader*)buff;
+	struct ReportZonesEntry* entries = (struct ReportZonesEntry*)(&buff[sizeof(struct ReportZonesHeader)]);
+	if (buffLen < sizeof(struct ReportZonesHeader)){
+		return true;
+	}
+	uint32_t maxEntries = (buffLen - sizeof(struct ReportZonesHeader)) / sizeof(struct ReportZonesEntry);
+
+	// Kernel zones are all the same size, except possibly a smaller last zone
+	header->options = dev->capacitySectors % dev->zoneSectors ? SAMEOPT_LASTDIFF : SAMEOPT_TYPEDIFF;
+	header->maxOpenSeqZones = dev->maxOpenZones;
+
+	// Like REPORT ZONES DMA, start from the zone containing lba
+	uint64_t sector = lba << dev->lbaShift;
+	sector -= sector % dev->zoneSectors;
+	uint32_t batch = reportingOptions == ROPT_ALL && maxEntries < BLK_REPORT_BATCH ? maxEntries : BLK_REPORT_BATCH;
+	struct blk_zone_report* report = (struct blk_zone_report*) malloc(sizeof(struct blk_zone_report) + sizeof(struct blk_zone) * (batch ? batch : 1));
+	if (!report){
+		fprintf(stderr, "Error: Could not allocate BLKREPORTZONE buffer\n");
+		return false;
+	}
+
+	uint32_t numEntries = 0;
+	uint32_t numMatching = 0;
+	while (sector < dev->capacitySectors){
+		if (numEntries == maxEntries && (reportingOptions == ROPT_ALL || !countAll)){
+			break;	// Buffer full, and the remaining zone count is either known or not needed
+		}
+		memset(report, 0, sizeof(struct blk_zone_report));
+		report->sector = sector;
+		report->nr_zones = reportingOptions == ROPT_ALL && maxEntries - numEntries < batch ? maxEntries - numEntries : batch;
+		if (ioctl(dev->fd, BLKREPORTZONE, report) < 0){
+			perror("BLKREPORTZONE error");
+			free(report);
+			return false;
+		}
+		if (report->nr_zones == 0){
+			break;
+		}
+		for (uint32_t i=0; i<report->nr_zones; i++){
+			if (!zoneDevBlkZoneMatches(&report->zones[i], reportingOptions)){
+				continue;
+			}
+			if (numEntries < maxEntries){
+				zoneDevBlkZoneToEntry(dev, &report->zones[i], &entries[numEntries++]);
+			}
+			numMatching++;
+		}
+		struct blk_zone* lastZone = &report->zones[report->nr_zones-1];
+		sector = lastZone->start + lastZone->len;
+	}
+	free(report);
+
+	if (reportingOptions == ROPT_ALL){
+		uint64_t firstZone = (lba << dev->lbaShift) / dev->zoneSectors;
+		numMatching = firstZone < dev->numZones ? dev->numZones - firstZone : 0;
+	}
+	header->zoneListLength = numMatching * sizeof(struct ReportZonesEntry);
+	return true;
+}
+
+/// Retrieve REPORT ZONES DMA data (header and records) for the zones from the one containing lba into buff.
+/// buffLen must be a multiple of 512.  With BACKEND_BLK and reporting options other than ROPT_ALL, the zone list
+/// length may fall short of the total once buff is full; zoneDevReportHeader counts them all.  Returns success.
+bool zoneDevReportZones(struct ZoneDevice* dev, uint64_t lba, uint8_t reportingOptions, uint8_t* buff, unsigned int buffLen){
+	if (dev->backend == BACKEND_BLK){
+		return blkReportZones(dev, lba, reportingOptions, buff, buffLen, false);
+	}
+	return ataPassthrough16(
+		&dev->fd,
+		ATA_REPORT_ZONES_DMA,
+		(reportingOptions << 8) | 0x00,
+		buffLen / 512,
+		lba,
+		0x1<<6,	// Device bit 6 "shall be set to one"
+		ATA_PROTOCOL_DMA,
+		// Transfer n 512-byte blocks from device, where n is sector count
+		ATA_FLAGS_TDIR | ATA_FLAGS_BYTBLK | ATA_FLAGS_TLEN_SECC,
+		SG_DXFER_FROM_DEV,
+		buff,
+		buffLen,
+		NULL,
+		0
+	);
+}
+
+/// Retrieve the REPORT ZONES DMA header for the zones from the one containing lba, and the first record if
+/// firstEntry is not NULL.  Fails if the command was aborted (i.e. not a ZAC drive).  Returns success.
+bool zoneDevReportHeader(struct ZoneDevice* dev, uint64_t lba, uint8_t reportingOptions, struct ReportZonesHeader* header, struct ReportZonesEntry* firstEntry){
+	uint8_t zoneHeaderBuff[512] = {0};	// Although the header is 64 bytes, we must retrieve at minimum one sector
+	if (dev->backend == BACKEND_BLK){
+		if (!blkReportZones(dev, lba, reportingOptions, zoneHeaderBuff, sizeof(zoneHeaderBuff), true)){
+			return false;
+		}
+		*header = *(struct ReportZonesHeader*)zoneHeaderBuff;
+		if (firstEntry){
+			*firstEntry = *(struct ReportZonesEntry*)(&zoneHeaderBuff[sizeof(struct ReportZonesHeader)]);
+		}
+		return true;
+	}
+
+	uint8_t senseBuff[32] = {0};
+	if (!ataPassthrough16(
+		&dev->fd,
+		ATA_REPORT_ZONES_DMA,
+		(reportingOptions << 8) | 0x00,
+		1,
+		lba,
+		0x1<<6,
+		ATA_PROTOCOL_DMA,
+		ATA_FLAGS_CKCOND | ATA_FLAGS_TDIR | ATA_FLAGS_BYTBLK | ATA_FLAGS_TLEN_SECC,
+		SG_DXFER_FROM_DEV,
+		zoneHeaderBuff,
+		sizeof(zoneHeaderBuff),
+		senseBuff,
+		sizeof(senseBuff)
+	)){ return false; }
+
+	struct KeyCodeQualifier kcq;
+	if (!getSenseErrors(senseBuff, &kcq)){
+		fprintf(stderr, "Error: Could not parse sense buffer from REPORT ZONES DMA command\n");
+		return false;
+	}
+	if (assertKcq(&kcq, ABORTED_COMMAND, ASC_NO_ADDITIONAL_SENSE_INFORMATION)){
+		fprintf(stderr, "Error: Command was aborted, is this a ZAC drive?\n");
+		return false;
+	}
+	*header = *(struct ReportZonesHeader*)zoneHeaderBuff;
+	if (firstEntry){
+		*firstEntry = *(struct ReportZonesEntry*)(&zoneHeaderBuff[sizeof(struct ReportZonesHeader)]);
+	}
+	return true;
+}
+
+/// Issue RESET WRITE POINTER through ATA PASS-THROUGH, and report the reason on failure.  Returns success.
+static bool ataResetWritePointer(struct ZoneDevice* dev, uint64_t lba, bool resetAll){
+	uint8_t senseBuff[32] = {0};
+	if (!ataPassthrough16(
+		&dev->fd,
+		ATA_RESET_WRITE_POINTER,
+		(resetAll ? RESET_ALL_BIT : 0) | ACTION_RESET_WRITE_POINTER,
+		0x0000,
+		lba,
+		0x00,
+		ATA_PROTOCOL_NONDATA,
+		ATA_FLAGS_CKCOND,
+		SG_DXFER_NONE,
+		NULL,
+		0,
+		senseBuff,
+		sizeof(senseBuff)
+	)){ return false; }
+
+	// Check if command completed successfully
+	struct KeyCodeQualifier kcq;
+	if (!getSenseErrors(senseBuff, &kcq)){
+		fprintf(stderr, "Error: Could not parse sense buffer from RESET WRITE POINTER command\n");
+		return false;
+	}
+	if (kcq.senseKey == NO_SENSE || assertKcq(&kcq, RECOVERED_ERROR, ASC_ATA_PASS_THROUGH_INFORMATION_AVAILABLE)){
+		return true;
+	}
+
+	// Issue REQUEST SENSE DATA EXT if reset failed
+	memset(senseBuff, 0, sizeof(senseBuff));
+	if (!ataPassthrough16(
+		&dev->fd,
+		ATA_REQUEST_SENSE_DATA_EXT,
+		0x0000,
+		0x0000,
+		0,
+		0x00,
+		ATA_PROTOCOL_NONDATA,
+		ATA_FLAGS_CKCOND,
+		SG_DXFER_NONE,
+		NULL,
+		0,
+		senseBuff,
+		sizeof(senseBuff)
+	)){ return false; }
+
+	memset(&kcq, 0, sizeof(kcq));
+	struct AtaStatusReturnDescriptor ataReturn;
+	if (!getSenseErrors(senseBuff, &kcq) || !senseToAtaRegisters(senseBuff, &ataReturn)){
+		fprintf(stderr, "Error: Could not parse sense buffer from REQUEST SENSE DATA EXT command\n");
+		return false;
+	}
+	if (assertKcq(&kcq, RECOVERED_ERROR, ASC_ATA_PASS_THROUGH_INFORMATION_AVAILABLE)){
+		// Key Code Qualifier is stored in LBA registers of ATA descriptor.  Use that to extract error codes.
+		kcq.senseKey = ataReturn.lbaHigh & 0xff;
+		kcq.asc = ataReturn.lbaMid & 0xff;
+		kcq.ascq = ataReturn.lbaLow & 0xff;
+	}
+
+	if (assertKcq(&kcq, ABORTED_COMMAND, ASC_NO_ADDITIONAL_SENSE_INFORMATION)){
+		fprintf(stderr, "Error: Command was aborted, is this a ZAC drive?\n");
+	} else if (assertKcq(&kcq, ILLEGAL_REQUEST, ASC_INVALID_FIELD_IN_CDB)){
+		fprintf(stderr, "Error: Input LBA does not specify start of write pointer zone\n");
+	} else if (assertKcq(&kcq, ILLEGAL_REQUEST, ASC_RESET_WRITE_POINTER_NOT_ALLOWED)){
+		fprintf(stderr, "Error: Zone condition is OFFLINE\n");
+	} else if (assertKcq(&kcq, DATA_PROTECT, ASC_ZONE_IS_READ_ONLY)){
+		fprintf(stderr, "Error: Zone condition is READ ONLY\n");
+	} else {
+		fprintf(stderr, "Error: RESET WRITE POINTER failed.  Sense data: (SK=0x%02x, ASC=0x%02x, ASCQ=0x%02x)\n", kcq.senseKey, kcq.asc, kcq.ascq);
+	}
+	return false;
+}
+
+/// Issue BLKRESETZONE over nrSectors 512-byte sectors from sector.  Returns success.
+static bool blkResetZones(struct ZoneDevice* dev, uint64_t sector, uint64_t nrSectors){
+	struct blk_zone_range range;
+	range.sector = sector;
+	range.nr_sectors = nrSectors;
+	if (ioctl(dev->fd, BLKRESETZONE, &range) < 0){
+		perror("BLKRESETZONE error");
+		if (sector % dev->zoneSectors != 0){
+			fprintf(stderr, "Error: Input LBA does not specify start of write pointer zone\n");
+		}
+		return false;
+	}
+	return true;
+}
+
+/// Reset the write pointer of the zone starting at lba, or of all zones if resetAll is set.  Returns success.
+bool zoneDevResetWritePointer(struct ZoneDevice* dev, uint64_t lba, bool resetAll){
+	if (dev->backend != BACKEND_BLK){
+		return ataResetWritePointer(dev, lba, resetAll);
+	}
+	if (resetAll){
+		return blkResetZones(dev, 0, dev->capacitySectors);
+	}
+	uint64_t sector = lba << dev->lbaShift;
+	uint64_t nrSectors = dev->zoneSectors;
+	if (sector < dev->capacitySectors && dev->capacitySectors - sector < nrSectors){
+		nrSectors = dev->capacitySectors - sector;	// Smaller last zone
+	}
+	return blkResetZones(dev, sector, nrSectors);
+}
+
+/// Reset the write pointers of numZones zones starting with the zone at lba, which must be a zone start LBA.
+/// Zones without a write pointer are skipped.  The kernel backend resets each run of consecutive write pointer zones in one call.  Returns success.
+bool zoneDevResetRange(struct ZoneDevice* dev, uint64_t lba, uint32_t numZones){
+	unsigned int buffLen = sizeof(struct ReportZonesHeader) + sizeof(struct ReportZonesEntry)*REPORT_ZONES_ENTRY_BUFFER_SIZE;
+	buffLen += (512 - buffLen%512) % 512;
+	uint8_t* dataBuff = (uint8_t*) malloc(buffLen);
+	if (!dataBuff){
+		fprintf(stderr, "Error: Could not allocate REPORT ZONES DMA buffer\n");
+		return false;
+	}
+
+	uint64_t runStart = 0;		// Start LBA and length of pending run of write pointer zones (BACKEND_BLK)
+	uint64_t runLength = 0;
+	uint64_t currLba = lba;
+	uint32_t remaining = numZones;
+	bool success = true;
+	while (success && remaining > 0){
+		if (!zoneDevReportZones(dev, currLba, ROPT_ALL, dataBuff, buffLen)){
+			success = false;
+			break;
+		}
+		struct ReportZonesEntry* entries = (struct ReportZonesEntry*)(&dataBuff[sizeof(struct ReportZonesHeader)]);
+		uint32_t numRecords = (*(struct ReportZonesHeader*)dataBuff).zoneListLength / sizeof(struct ReportZonesEntry);
+		if (numRecords > REPORT_ZONES_ENTRY_BUFFER_SIZE){
+			numRecords = REPORT_ZONES_ENTRY_BUFFER_SIZE;
+		}
+		if (numRecords == 0){
+			break;
+		}
+		if (currLba == lba && entries[0].zoneStartLba != lba){
+			// Same check as a single zone reset, rather than silently resetting the zone containing lba
+			fprintf(stderr, "Error: Input LBA does not specify start of a zone\n");
+			success = false;
+			break;
+		}
+		for (uint32_t i=0; success && i<numRecords && remaining > 0; i++, remaining--){
+			struct ReportZonesEntry* entry = &entries[i];
+			if ((entry->options & 0xF) == ZONETYPE_CMR){
+				continue;
+			}
+			if (dev->backend != BACKEND_BLK){
+				success = ataResetWritePointer(dev, entry->zoneStartLba, false);
+			} else if (runLength > 0 && runStart + runLength == entry->zoneStartLba){
+				runLength += entry->zoneLength;
+			} else {
+				if (runLength > 0){
+					success = blkResetZones(dev, runStart << dev->lbaShift, runLength << dev->lbaShift);
+				}
+				runStart = entry->zoneStartLba;
+				runLength = entry->zoneLength;
+			}
+		}
+		struct ReportZonesEntry* lastEntry = &entries[numRecords-1];
+		currLba = lastEntry->zoneStartLba + lastEntry->zoneLength;
+	}
+	if (success && runLength > 0){
+		success = blkResetZones(dev, runStart << dev->lbaShift, runLength << dev->lbaShift);
+	}
+	free(dataBuff);
+	return success;
+}
@@ -0,0 +1,48 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for zoned device access through either ATA PASS-THROUGH or the kernel zoned block layer
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_ZONEDEV_H
+#define ZACUTILS_ZONEDEV_H
+
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <linux/blkzoned.h>
+#include "reportzones.h"
+#include "resetzones.h"
+
+/// Kernel zoned block ioctls count in 512-byte sectors regardless of the logical sector size
+#define BLK_SECTOR_SHIFT 9
+
+/// Largest number of zones requested per BLKREPORTZONE call
+#define BLK_REPORT_BATCH 16384
+
+/// Zone command backends
+enum ZoneBackends {
+	BACKEND_ATA = 0,	// ATA PASS-THROUGH(16) through SG_IO
+	BACKEND_BLK = 1		// BLKREPORTZONE/BLKRESETZONE on a kernel zoned block device
+};
+
+/// Open zoned device.  LBAs are always in logical sectors of sectorSize bytes, whichever the backend.
+struct ZoneDevice {
+	int fd;
+	enum ZoneBackends backend;
+	uint32_t sectorSize;
+	uint32_t lbaShift;		// log2(sectorSize / 512), BACKEND_BLK only
+	uint32_t numZones;		// BACKEND_BLK only
+	uint64_t zoneSectors;		// Zone size in 512-byte sectors, BACKEND_BLK only
+	uint64_t capacitySectors;	// Device size in 512-byte sectors, BACKEND_BLK only
+	uint32_t maxOpenZones;		// From sysfs, 0 if unknown, BACKEND_BLK only
+};
+
+bool zoneDevOpen(struct ZoneDevice* dev, const char* deviceFile, enum ZoneBackends backend);
+void zoneDevClose(struct ZoneDevice* dev);
+bool zoneDevReportZones(struct ZoneDevice* dev, uint64_t lba, uint8_t reportingOptions, uint8_t* buff, unsigned int buffLen);
+bool zoneDevReportHeader(struct ZoneDevice* dev, uint64_t lba, uint8_t reportingOptions, struct ReportZonesHeader* header, struct ReportZonesEntry* firstEntry);
+bool zoneDevResetWritePointer(struct ZoneDevice* dev, uint64_t lba, bool resetAll);
+bool zoneDevResetRange(struct ZoneDevice* dev, uint64_t lba, uint32_t numZones);
+bool zoneDevBlkZoneMatches(const struct blk_zone* zone, uint8_t reportingOptions);
+void zoneDevBlkZoneToEntry(const struct ZoneDevice* dev, const struct blk_zone* zone, struct ReportZonesEntry* entry);
+
+#endif
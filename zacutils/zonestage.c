@@ -0,0 +1,1012 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * CMR staging layer.  Writes to a block-addressed volume are appended to a log in the conventional (CMR) zones,
+ * where random writes are cheap.  A background thread destages them, sorted by logical block and with only the
+ * latest copy of each block, to the write pointer of the sequential zones.  A mapping table from logical block
+ * to LBA is checkpointed into the CMR zones after each destage; on open, the log records written since the last
+ * checkpoint are replayed on top of it and destaged.
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#include <errno.h>
+#include "zonestage.h"
+
+/// LBA of log block i
+static inline uint64_t stageLogLba(const struct ZoneStage* stage, uint64_t i){
+	return stage->sb.logLba + i * stage->blockSectors;
+}
+
+/// Returns whether lba lies in the log (rather than a data zone)
+static inline bool stageInLog(const struct ZoneStage* stage, uint64_t lba){
+	return lba >= stage->sb.logLba && lba < stageLogLba(stage, stage->sb.logBlocks);
+}
+
+/// Start LBA of data zone k
+static inline uint64_t stageZoneLba(const struct ZoneStage* stage, uint32_t k){
+	return stage->sb.dataLba + (uint64_t)k * stage->sb.zoneSectors;
+}
+
+/// Data zone holding lba
+static inline uint32_t stageLbaZone(const struct ZoneStage* stage, uint64_t lba){
+	return (lba - stage->sb.dataLba) / stage->sb.zoneSectors;
+}
+
+/// Read or write len bytes at byte offset, retrying short transfers.  Returns success.
+static bool stageIo(int fd, bool write, uint8_t* buff, uint64_t offset, size_t len){
+	size_t done = 0;
+	while (done < len){
+		ssize_t ret = write ? pwrite(fd, buff + done, len - done, offset + done) : pread(fd, buff + done, len - done, offset + done);
+		if (ret <= 0){
+			fprintf(stderr, "Error: %s failed at byte offset %#lx: %s\n", write ? "Write" : "Read", offset + done, ret < 0 ? strerror(errno) : "end of device");
+			return false;
+		}
+		done += ret;
+	}
+	return true;
+}
+
+static uint32_t stageSuperblockCrc(struct StageSuperblock sb){
+	sb.crc = 0;
+	return crc32c(0, &sb, sizeof(sb));
+}
+
+static uint32_t stageCheckpointCrc(struct StageCheckpointHeader header){
+	header.crc = 0;
+	return crc32c(0, &header, sizeof(header));
+}
+
+static uint32_t stageRecordCrc(struct StageRecordHeader header){
+	header.crc = 0;
+	return crc32c(0, &header, sizeof(header));
+}
+
+/// Lay out a staged volume on the zones in table: superblock, checkpoint slots and log in the first run of
+/// contiguous CMR zones, data in the first run of contiguous, equally long sequential zones (at most
+/// maxDataZones of them, 0 for all).  Fills in the layout fields of sb.  Returns the table index of the first
+/// data zone, or ZONETABLE_NONE if the volume does not fit.
+static uint32_t stageLayout(const struct ZoneTable* table, uint32_t sectorSize, uint32_t blockSize, uint32_t maxDataZones, struct StageSuperblock* sb){
+	uint32_t blockSectors = blockSize / sectorSize;
+	uint32_t i = 0;
+	while (i < table->numZones && zoneTableType(table, i) != ZONETYPE_CMR){
+		i++;
+	}
+	if (i == table->numZones){
+		fprintf(stderr, "Error: Device has no CMR zones to stage writes in\n");
+		return ZONETABLE_NONE;
+	}
+	uint64_t metaLba = zoneTableStartLba(table, i);
+	uint64_t metaSectors = 0;
+	for (; i < table->numZones && zoneTableType(table, i) == ZONETYPE_CMR && zoneTableStartLba(table, i) == metaLba + metaSectors; i++){
+		metaSectors += zoneTableLength(table, i);
+	}
+
+	uint32_t first = 0;
+	while (first < table->numZones && zoneTableType(table, first) != ZONETYPE_SMR){
+		first++;
+	}
+	if (first == table->numZones){
+		fprintf(stderr, "Error: Device has no sequential zones to destage to\n");
+		return ZONETABLE_NONE;
+	}
+	uint64_t dataLba = zoneTableStartLba(table, first);
+	uint64_t zoneSectors = zoneTableLength(table, first);
+	uint32_t numDataZones = 0;
+	while (first + numDataZones < table->numZones
+		&& (maxDataZones == 0 || numDataZones < maxDataZones)
+		&& zoneTableType(table, first + numDataZones) == ZONETYPE_SMR
+		&& zoneTableLength(table, first + numDataZones) == zoneSectors
+		&& zoneTableStartLba(table, first + numDataZones) == dataLba + numDataZones * zoneSectors){
+		numDataZones++;
+	}
+	if (zoneSectors % blockSectors != 0){
+		fprintf(stderr, "Error: Zone length of %lu sectors is not a multiple of the %u-byte block size\n", zoneSectors, blockSize);
+		return ZONETABLE_NONE;
+	}
+
+	// Size the mapping table for every data zone first; the reserve zones only make it smaller
+	uint64_t zoneBlocks = zoneSectors / blockSectors;
+	uint64_t metaBlocks = metaSectors / blockSectors;
+	uint64_t entriesPerBlock = blockSize / sizeof(uint64_t);
+	uint64_t mapBlocks = (numDataZones * zoneBlocks + entriesPerBlock - 1) / entriesPerBlock;
+	if (metaBlocks < 1 + 2*(1 + mapBlocks) + STAGE_MIN_LOG_BLOCKS){
+		fprintf(
+			stderr,
+			"Error: CMR zones (%lu blocks) are too small for the log and the mapping table of %u sequential zones.  "
+			"Use fewer zones or larger blocks.\n",
+			metaBlocks,
+			numDataZones
+		);
+		return ZONETABLE_NONE;
+	}
+	uint64_t logBlocks = metaBlocks - 1 - 2*(1 + mapBlocks);
+	uint32_t reserveZones = (logBlocks + zoneBlocks - 1) / zoneBlocks + 1;
+	if (reserveZones >= numDataZones){
+		fprintf(stderr, "Error: %u sequential zones are too few for a log of %lu blocks\n", numDataZones, logBlocks);
+		return ZONETABLE_NONE;
+	}
+
+	sb->blockSize = blockSize;
+	sb->sectorSize = sectorSize;
+	sb->numBlocks = (numDataZones - reserveZones) * zoneBlocks;
+	sb->mapBlocks = (sb->numBlocks + entriesPerBlock - 1) / entriesPerBlock;
+	sb->metaLba = metaLba;
+	sb->checkpointLba[0] = metaLba + blockSectors;
+	sb->checkpointLba[1] = sb->checkpointLba[0] + (1 + sb->mapBlocks) * blockSectors;
+	sb->logLba = sb->checkpointLba[1] + (1 + sb->mapBlocks) * blockSectors;
+	sb->logBlocks = metaBlocks - 1 - 2*(1 + sb->mapBlocks);
+	if (sb->logBlocks > (reserveZones - 1) * zoneBlocks){
+		sb->logBlocks = (reserveZones - 1) * zoneBlocks;	// Destaging a full log must fit in the reserve
+	}
+	sb->dataLba = dataLba;
+	sb->zoneSectors = zoneSectors;
+	sb->numDataZones = numDataZones;
+	sb->reserveZones = reserveZones;
+	return first;
+}
+
+/// Write a checkpoint slot header from buff (one block).  Returns success.
+static bool stageWriteCheckpointHeader(int fd, const struct StageSuperblock* sb, uint32_t slot, uint64_t seq, uint64_t tailBlock, uint64_t tailSeq, uint8_t* buff){
+	struct StageCheckpointHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, STAGE_CHECKPOINT_MAGIC, sizeof(header.magic));
+	header.volumeId = sb->volumeId;
+	header.seq = seq;
+	header.tailBlock = tailBlock;
+	header.tailSeq = tailSeq;
+	header.crc = stageCheckpointCrc(header);
+	memset(buff, 0, sb->blockSize);
+	memcpy(buff, &header, sizeof(header));
+	return stageIo(fd, true, buff, sb->checkpointLba[slot] * sb->sectorSize, sb->blockSize);
+}
+
+/// Format deviceFile as an empty staged volume of blockSize-byte blocks, on at most maxDataZones sequential zones
+/// (0 for all).  All data zones are reset.  Fills in sb.  Returns success.
+bool stageFormat(const char* deviceFile, enum ZoneBackends backend, uint32_t blockSize, uint32_t maxDataZones, struct StageSuperblock* sb){
+	struct ZoneDevice dev;
+	struct ReportZonesHeader zoneHeader;
+	struct ZoneTable table;
+	if (!zoneDevOpen(&dev, deviceFile, backend)){
+		return false;
+	}
+	if (blockSize < STAGE_MIN_BLOCK_SIZE || (blockSize & (blockSize - 1)) != 0 || blockSize % dev.sectorSize != 0){
+		fprintf(stderr, "Error: Block size must be a power of 2 of at least %u bytes\n", STAGE_MIN_BLOCK_SIZE);
+		zoneDevClose(&dev);
+		return false;
+	}
+	if (!zoneTableReportAll(&dev, &table, &zoneHeader)){
+		zoneDevClose(&dev);
+		return false;
+	}
+	memset(sb, 0, sizeof(*sb));
+	bool success = stageLayout(&table, dev.sectorSize, blockSize, maxDataZones, sb) != ZONETABLE_NONE;
+	zoneTableFree(&table);
+
+	int fd = -1;
+	uint8_t* buff = NULL;
+	if (success && (fd = open(deviceFile, O_RDWR | O_DIRECT)) < 0){
+		perror("Error opening device");
+		success = false;
+	}
+	if (success && posix_memalign((void**)&buff, COPY_BUFFER_ALIGN, (size_t)STAGE_MOVE_BLOCKS * blockSize) != 0){
+		fprintf(stderr, "Error: Could not allocate transfer buffer\n");
+		buff = NULL;
+		success = false;
+	}
+	success = success && zoneDevResetRange(&dev, sb->dataLba, sb->numDataZones);
+
+	struct timespec now;
+	clock_gettime(CLOCK_REALTIME, &now);
+	memcpy(sb->magic, STAGE_SUPERBLOCK_MAGIC, sizeof(sb->magic));
+	sb->version = STAGE_VERSION;
+	sb->volumeId = ((uint64_t)now.tv_sec << 32) ^ now.tv_nsec ^ ((uint64_t)getpid() << 16);
+	sb->crc = stageSuperblockCrc(*sb);
+
+	// Both checkpoint slots start out with an empty mapping table (checkpoint n goes to slot n%2), and the log
+	// with the first record
+	for (uint32_t slot = 0; success && slot < 2; slot++){
+		uint64_t mapLba = sb->checkpointLba[slot] + blockSize / sb->sectorSize;
+		memset(buff, 0xFF, (size_t)STAGE_MOVE_BLOCKS * blockSize);
+		for (uint64_t done = 0; success && done < sb->mapBlocks; done += STAGE_MOVE_BLOCKS){
+			uint64_t count = sb->mapBlocks - done < STAGE_MOVE_BLOCKS ? sb->mapBlocks - done : STAGE_MOVE_BLOCKS;
+			success = stageIo(fd, true, buff, (mapLba + done * (blockSize / sb->sectorSize)) * sb->sectorSize, count * blockSize);
+		}
+		success = success && stageWriteCheckpointHeader(fd, sb, slot, slot, 0, 1, buff);
+	}
+	if (success && fdatasync(fd) < 0){
+		perror("Error flushing device");
+		success = false;
+	}
+	if (success){
+		memset(buff, 0, blockSize);
+		memcpy(buff, sb, sizeof(*sb));
+		success = stageIo(fd, true, buff, sb->metaLba * sb->sectorSize, blockSize);
+	}
+	if (success && fdatasync(fd) < 0){
+		perror("Error flushing device");
+		success = false;
+	}
+	free(buff);
+	if (fd >= 0){
+		close(fd);
+	}
+	zoneDevClose(&dev);
+	return success;
+}
+
+/// Point logical block at lba, keeping zone valid counts and dirty map blocks.  Caller holds mapLock for writing.
+static void stageSetMapping(struct ZoneStage* stage, uint64_t block, uint64_t lba){
+	uint64_t old = stage->map[block];
+	if (old != STAGE_UNMAPPED && !stageInLog(stage, old)){
+		stage->zoneValid[stageLbaZone(stage, old)]--;
+	}
+	if (lba != STAGE_UNMAPPED && !stageInLog(stage, lba)){
+		stage->zoneValid[stageLbaZone(stage, lba)]++;
+	}
+	stage->map[block] = lba;
+	stage->pageGen[block / stage->entriesPerBlock] = stage->checkpointSeq + 1;
+}
+
+/// Load the mapping table from the newer valid checkpoint slot and return where log replay starts.
+/// Returns success.
+static bool stageLoadCheckpoint(struct ZoneStage* stage, uint64_t* tailBlock, uint64_t* tailSeq){
+	struct StageCheckpointHeader headers[2];
+	int newest = -1;
+	for (uint32_t slot = 0; slot < 2; slot++){
+		if (!stageIo(stage->fd, false, stage->moveBuff, stage->sb.checkpointLba[slot] * stage->sb.sectorSize, stage->sb.blockSize)){
+			return false;
+		}
+		memcpy(&headers[slot], stage->moveBuff, sizeof(headers[slot]));
+		if (memcmp(headers[slot].magic, STAGE_CHECKPOINT_MAGIC, sizeof(headers[slot].magic)) != 0
+			|| headers[slot].volumeId != stage->sb.volumeId
+			|| headers[slot].crc != stageCheckpointCrc(headers[slot])){
+			continue;
+		}
+		if (newest < 0 || headers[slot].seq > headers[newest].seq){
+			newest = slot;
+		}
+	}
+	if (newest < 0){
+		fprintf(stderr, "Error: No valid checkpoint of the staged volume\n");
+		return false;
+	}
+	uint64_t mapLba = stage->sb.checkpointLba[newest] + stage->blockSectors;
+	if (!stageIo(stage->fd, false, (uint8_t*)stage->map, mapLba * stage->sb.sectorSize, (size_t)stage->sb.mapBlocks * stage->sb.blockSize)){
+		return false;
+	}
+	// The other slot may differ anywhere, so the next checkpoint (which goes there) writes every map block
+	stage->checkpointSeq = headers[newest].seq;
+	for (uint64_t p = 0; p < stage->sb.mapBlocks; p++){
+		stage->pageGen[p] = stage->checkpointSeq;
+	}
+	*tailBlock = headers[newest].tailBlock;
+	*tailSeq = headers[newest].tailSeq;
+	return *tailBlock <= stage->sb.logBlocks;
+}
+
+/// Read the record header at log block into logBuff and return whether it is the valid record with sequence
+/// number seq
+static bool stageReadRecordHeader(struct ZoneStage* stage, uint64_t block, uint64_t seq, struct StageRecordHeader* header){
+	if (!stageIo(stage->fd, false, stage->logBuff, stageLogLba(stage, block) * stage->sb.sectorSize, stage->sb.blockSize)){
+		return false;
+	}
+	memcpy(header, stage->logBuff, sizeof(*header));
+	return memcmp(header->magic, STAGE_RECORD_MAGIC, sizeof(header->magic)) == 0
+		&& header->volumeId == stage->sb.volumeId
+		&& header->seq == seq
+		&& header->crc == stageRecordCrc(*header);
+}
+
+/// Add a record to the list of records not yet destaged.  Caller holds logLock.  Returns success.
+static bool stageAddRecord(struct ZoneStage* stage, const struct StageRecord* record){
+	if (stage->numRecords == stage->recordCapacity){
+		uint32_t capacity = stage->recordCapacity ? stage->recordCapacity * 2 : 64;
+		struct StageRecord* records = (struct StageRecord*) realloc(stage->records, sizeof(struct StageRecord) * capacity);
+		if (!records){
+			fprintf(stderr, "Error: Could not allocate log record list\n");
+			return false;
+		}
+		stage->records = records;
+		stage->recordCapacity = capacity;
+	}
+	stage->records[stage->numRecords++] = *record;
+	stage->logUsed += record->footprint;
+	return true;
+}
+
+/// Replay the log from the checkpoint tail: apply each consecutive valid record to the mapping table and list it
+/// for destaging.  Replay stops at the first record that is missing, torn or from an earlier pass over the log.
+/// Returns success.
+static bool stageReplay(struct ZoneStage* stage, uint64_t tailBlock, uint64_t tailSeq){
+	uint64_t block = tailBlock;
+	uint64_t seq = tailSeq;
+	uint64_t startBlock = block;	// Start of the current record, including a preceding wrap record
+	uint64_t startSeq = seq;
+	uint64_t skipped = 0;
+	struct StageRecordHeader header;
+	for (;;){
+		if (block == stage->sb.logBlocks){
+			block = 0;
+		}
+		if (!stageReadRecordHeader(stage, block, seq, &header)){
+			break;
+		}
+		if (header.type == STAGE_RECORD_WRAP){
+			skipped += stage->sb.logBlocks - block;
+			block = 0;
+			seq++;
+			continue;
+		}
+		if (header.type != STAGE_RECORD_WRITE
+			|| header.numBlocks == 0
+			|| header.numBlocks > STAGE_MAX_RECORD_BLOCKS
+			|| block + 1 + header.numBlocks > stage->sb.logBlocks
+			|| header.logicalBlock + header.numBlocks > stage->sb.numBlocks){
+			break;
+		}
+		uint8_t* data = stage->logBuff + stage->sb.blockSize;
+		size_t len = (size_t)header.numBlocks * stage->sb.blockSize;
+		if (!stageIo(stage->fd, false, data, stageLogLba(stage, block + 1) * stage->sb.sectorSize, len)){
+			return false;
+		}
+		if (crc32c(0, data, len) != header.dataCrc){
+			break;
+		}
+		for (uint32_t j = 0; j < header.numBlocks; j++){
+			stage->map[header.logicalBlock + j] = stageLogLba(stage, block + 1 + j);
+			stage->pageGen[(header.logicalBlock + j) / stage->entriesPerBlock] = stage->checkpointSeq + 1;
+		}
+		struct StageRecord record = {
+			.logicalBlock = header.logicalBlock,
+			.dataBlock = block + 1,
+			.startBlock = startBlock,
+			.seq = startSeq,
+			.numBlocks = header.numBlocks,
+			.footprint = skipped + 1 + header.numBlocks
+		};
+		if (!stageAddRecord(stage, &record)){
+			return false;
+		}
+		stage->recordsReplayed++;
+		block += 1 + header.numBlocks;
+		seq++;
+		startBlock = block;
+		startSeq = seq;
+		skipped = 0;
+	}
+	// A trailing wrap record is overwritten by the next record
+	stage->logHead = startBlock;
+	stage->nextSeq = startSeq;
+	return true;
+}
+
+static void stageRelease(struct ZoneStage* stage){
+	if (stage->fd >= 0){
+		close(stage->fd);
+	}
+	zoneDevClose(&stage->dev);
+	free(stage->map);
+	free(stage->pageGen);
+	free(stage->zoneValid);
+	free(stage->zoneWp);
+	free(stage->records);
+	free(stage->logBuff);
+	free(stage->moveBuff);
+	pthread_mutex_destroy(&stage->logLock);
+	pthread_rwlock_destroy(&stage->mapLock);
+	pthread_mutex_destroy(&stage->destageLock);
+	pthread_cond_destroy(&stage->destageCond);
+	pthread_cond_destroy(&stage->spaceCond);
+}
+
+/// Read and check the superblock, load the latest checkpoint and replay the log.  Returns success.
+static bool stageLoad(struct ZoneStage* stage, const char* deviceFile, const struct ZoneTable* table){
+	uint32_t i = 0;
+	while (i < table->numZones && zoneTableType(table, i) != ZONETYPE_CMR){
+		i++;
+	}
+	if (i == table->numZones){
+		fprintf(stderr, "Error: %s has no CMR zones, so it is not a staged volume\n", deviceFile);
+		return false;
+	}
+	if ((stage->fd = open(deviceFile, O_RDWR | O_DIRECT)) < 0){
+		perror("Error opening device");
+		return false;
+	}
+	if (posix_memalign((void**)&stage->moveBuff, COPY_BUFFER_ALIGN, STAGE_MIN_BLOCK_SIZE) != 0){
+		stage->moveBuff = NULL;
+		fprintf(stderr, "Error: Could not allocate superblock buffer\n");
+		return false;
+	}
+	if (!stageIo(stage->fd, false, stage->moveBuff, zoneTableStartLba(table, i) * stage->dev.sectorSize, STAGE_MIN_BLOCK_SIZE)){
+		return false;
+	}
+	memcpy(&stage->sb, stage->moveBuff, sizeof(stage->sb));
+	free(stage->moveBuff);
+	stage->moveBuff = NULL;
+	if (memcmp(stage->sb.magic, STAGE_SUPERBLOCK_MAGIC, sizeof(stage->sb.magic)) != 0
+		|| stage->sb.crc != stageSuperblockCrc(stage->sb)
+		|| stage->sb.version != STAGE_VERSION
+		|| stage->sb.sectorSize != stage->dev.sectorSize){
+		fprintf(stderr, "Error: %s is not a staged volume\n", deviceFile);
+		return false;
+	}
+	struct StageSuperblock layout = stage->sb;
+	uint32_t dataIndex = stageLayout(table, stage->sb.sectorSize, stage->sb.blockSize, stage->sb.numDataZones, &layout);
+	if (dataIndex == ZONETABLE_NONE || memcmp(&layout, &stage->sb, sizeof(layout)) != 0){
+		fprintf(stderr, "Error: Zone layout of %s does not match its staged volume superblock\n", deviceFile);
+		return false;
+	}
+
+	stage->blockSectors = stage->sb.blockSize / stage->sb.sectorSize;
+	stage->zoneBlocks = stage->sb.zoneSectors / stage->blockSectors;
+	stage->entriesPerBlock = stage->sb.blockSize / sizeof(uint64_t);
+	size_t blockSize = stage->sb.blockSize;
+	if (posix_memalign((void**)&stage->map, COPY_BUFFER_ALIGN, stage->sb.mapBlocks * blockSize) != 0){
+		stage->map = NULL;
+	}
+	if (posix_memalign((void**)&stage->logBuff, COPY_BUFFER_ALIGN, (1 + STAGE_MAX_RECORD_BLOCKS) * blockSize) != 0){
+		stage->logBuff = NULL;
+	}
+	if (posix_memalign((void**)&stage->moveBuff, COPY_BUFFER_ALIGN, STAGE_MOVE_BLOCKS * blockSize) != 0){
+		stage->moveBuff = NULL;
+	}
+	stage->pageGen = (uint64_t*) malloc(sizeof(uint64_t) * stage->sb.mapBlocks);
+	stage->zoneValid = (uint32_t*) calloc(stage->sb.numDataZones, sizeof(uint32_t));
+	stage->zoneWp = (uint32_t*) calloc(stage->sb.numDataZones, sizeof(uint32_t));
+	if (!stage->map || !stage->logBuff || !stage->moveBuff || !stage->pageGen || !stage->zoneValid || !stage->zoneWp){
+		fprintf(stderr, "Error: Could not allocate mapping table for %lu blocks\n", stage->sb.numBlocks);
+		return false;
+	}
+
+	for (uint32_t k = 0; k < stage->sb.numDataZones; k++){
+		stage->zoneWp[k] = (zoneTableWrittenLength(table, dataIndex + k) + stage->blockSectors - 1) / stage->blockSectors;
+	}
+	uint64_t tailBlock, tailSeq;
+	if (!stageLoadCheckpoint(stage, &tailBlock, &tailSeq) || !stageReplay(stage, tailBlock, tailSeq)){
+		return false;
+	}
+	for (uint64_t block = 0; block < stage->sb.numBlocks; block++){
+		uint64_t lba = stage->map[block];
+		if (lba == STAGE_UNMAPPED || stageInLog(stage, lba)){
+			continue;
+		}
+		uint32_t k = stageLbaZone(stage, lba);
+		if (lba < stage->sb.dataLba || k >= stage->sb.numDataZones){
+			fprintf(stderr, "Error: Block %#lx is mapped outside the staged volume, to LBA %#lx\n", block, lba);
+			return false;
+		}
+		stage->zoneValid[k]++;
+	}
+	return true;
+}
+
+static void* stageDestager(void* arg);
+static bool stageDestage(struct ZoneStage* stage);
+static bool stageCheckpoint(struct ZoneStage* stage, uint32_t dropRecords);
+
+/// Open the staged volume on deviceFile, recovering from the last checkpoint and the log, and start the
+/// destaging thread.  The replayed records are destaged first.  Returns success.
+bool stageOpen(struct ZoneStage* stage, const char* deviceFile, enum ZoneBackends backend){
+	memset(stage, 0, sizeof(*stage));
+	stage->fd = -1;
+	stage->dev.fd = -1;
+	stage->currZone = ZONETABLE_NONE;
+	pthread_mutex_init(&stage->logLock, NULL);
+	pthread_rwlock_init(&stage->mapLock, NULL);
+	pthread_mutex_init(&stage->destageLock, NULL);
+	pthread_cond_init(&stage->destageCond, NULL);
+	pthread_cond_init(&stage->spaceCond, NULL);
+
+	struct ReportZonesHeader zoneHeader;
+	struct ZoneTable table;
+	if (!zoneDevOpen(&stage->dev, deviceFile, backend)){
+		stageRelease(stage);
+		return false;
+	}
+	if (!zoneTableReportAll(&stage->dev, &table, &zoneHeader)){
+		stageRelease(stage);
+		return false;
+	}
+	bool success = stageLoad(stage, deviceFile, &table);
+	zoneTableFree(&table);
+
+	// Replay stopped at the first gap, but records written before the crash may follow it, with the sequence
+	// numbers the next records would get; a second crash would then replay them.  So destage what was replayed
+	// and checkpoint a log tail past every sequence number the log can still hold before accepting writes.
+	uint64_t loadedSeq = stage->checkpointSeq;
+	if (success){
+		stage->nextSeq += stage->sb.logBlocks + 1;
+		pthread_mutex_lock(&stage->destageLock);
+		success = stageDestage(stage) && (stage->checkpointSeq != loadedSeq || stageCheckpoint(stage, 0));
+		pthread_mutex_unlock(&stage->destageLock);
+	}
+	if (success && pthread_create(&stage->destager, NULL, stageDestager, stage) != 0){
+		fprintf(stderr, "Error: Could not start destaging thread\n");
+		success = false;
+	}
+	if (!success){
+		stageRelease(stage);
+		return false;
+	}
+	stage->destagerStarted = true;
+	return true;
+}
+
+/// Append one record of numBlocks blocks to the log and map them there, waiting for the destager if the log is
+/// full.  Caller holds logLock.  Returns success.
+static bool stageAppendRecord(struct ZoneStage* stage, uint64_t block, const uint8_t* buff, uint32_t numBlocks){
+	uint64_t logBlocks = stage->sb.logBlocks;
+	uint32_t need = 1 + numBlocks;
+	bool wrap;
+	uint64_t skipped;
+	for (;;){
+		if (stage->failed){
+			fprintf(stderr, "Error: Staged volume failed, refusing writes\n");
+			return false;
+		}
+		wrap = stage->logHead + need > logBlocks;
+		skipped = wrap ? logBlocks - stage->logHead : 0;
+		if (stage->logUsed + skipped + need <= logBlocks){
+			break;
+		}
+		pthread_cond_signal(&stage->destageCond);
+		pthread_cond_wait(&stage->spaceCond, &stage->logLock);
+	}
+
+	struct StageRecord record = {
+		.logicalBlock = block,
+		.startBlock = stage->logHead,
+		.seq = stage->nextSeq,
+		.numBlocks = numBlocks,
+		.footprint = skipped + need
+	};
+	size_t blockSize = stage->sb.blockSize;
+	struct StageRecordHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, STAGE_RECORD_MAGIC, sizeof(header.magic));
+	header.volumeId = stage->sb.volumeId;
+	if (wrap){
+		if (stage->logHead < logBlocks){
+			header.seq = stage->nextSeq++;
+			header.type = STAGE_RECORD_WRAP;
+			header.crc = stageRecordCrc(header);
+			memset(stage->logBuff, 0, blockSize);
+			memcpy(stage->logBuff, &header, sizeof(header));
+			if (!stageIo(stage->fd, true, stage->logBuff, stageLogLba(stage, stage->logHead) * stage->sb.sectorSize, blockSize)){
+				stage->failed = true;
+				return false;
+			}
+		}
+		stage->logHead = 0;
+	}
+	header.seq = stage->nextSeq;
+	header.logicalBlock = block;
+	header.numBlocks = numBlocks;
+	header.type = STAGE_RECORD_WRITE;
+	header.dataCrc = crc32c(0, buff, numBlocks * blockSize);
+	header.crc = stageRecordCrc(header);
+	memset(stage->logBuff, 0, blockSize);
+	memcpy(stage->logBuff, &header, sizeof(header));
+	memcpy(stage->logBuff + blockSize, buff, numBlocks * blockSize);
+	if (!stageIo(stage->fd, true, stage->logBuff, stageLogLba(stage, stage->logHead) * stage->sb.sectorSize, need * blockSize)){
+		stage->failed = true;	// The log position of a wrap record already written is not accounted for
+		return false;
+	}
+
+	record.dataBlock = stage->logHead + 1;
+	pthread_rwlock_wrlock(&stage->mapLock);
+	for (uint32_t j = 0; j < numBlocks; j++){
+		stageSetMapping(stage, block + j, stageLogLba(stage, record.dataBlock + j));
+	}
+	pthread_rwlock_unlock(&stage->mapLock);
+	if (!stageAddRecord(stage, &record)){
+		stage->failed = true;
+		return false;
+	}
+	stage->logHead += need;
+	stage->nextSeq++;
+	if (stage->logUsed * STAGE_DESTAGE_WATERMARK >= logBlocks){
+		pthread_cond_signal(&stage->destageCond);
+	}
+	return true;
+}
+
+/// Write numBlocks blocks from buff to the volume at logical block.  The write is logged in the CMR zones and
+/// durable once stageSync returns.  Returns success.
+bool stageWrite(struct ZoneStage* stage, uint64_t block, const uint8_t* buff, uint32_t numBlocks){
+	if (block > stage->sb.numBlocks || numBlocks > stage->sb.numBlocks - block){
+		fprintf(stderr, "Error: Write of %u blocks at %#lx is beyond the end of the staged volume\n", numBlocks, block);
+		return false;
+	}
+	bool success = true;
+	pthread_mutex_lock(&stage->logLock);
+	for (uint32_t done = 0; success && done < numBlocks; ){
+		uint32_t count = numBlocks - done < STAGE_MAX_RECORD_BLOCKS ? numBlocks - done : STAGE_MAX_RECORD_BLOCKS;
+		success = stageAppendRecord(stage, block + done, buff + (size_t)done * stage->sb.blockSize, count);
+		done += count;
+	}
+	pthread_mutex_unlock(&stage->logLock);
+	return success;
+}
+
+/// Read numBlocks blocks of the volume at logical block into buff, which must be aligned to COPY_BUFFER_ALIGN.
+/// Blocks never written read as zeroes.  Returns success.
+bool stageRead(struct ZoneStage* stage, uint64_t block, uint8_t* buff, uint32_t numBlocks){
+	if (block > stage->sb.numBlocks || numBlocks > stage->sb.numBlocks - block){
+		fprintf(stderr, "Error: Read of %u blocks at %#lx is beyond the end of the staged volume\n", numBlocks, block);
+		return false;
+	}
+	if ((uintptr_t)buff % COPY_BUFFER_ALIGN != 0){
+		fprintf(stderr, "Error: Read buffer is not aligned to %u bytes\n", COPY_BUFFER_ALIGN);
+		return false;
+	}
+	size_t blockSize = stage->sb.blockSize;
+	bool success = true;
+	pthread_rwlock_rdlock(&stage->mapLock);
+	for (uint32_t i = 0; success && i < numBlocks; ){
+		// Read each run of blocks mapped to consecutive LBAs in one transfer
+		uint64_t lba = stage->map[block + i];
+		uint32_t run = 1;
+		while (i + run < numBlocks && stage->map[block + i + run] == (lba == STAGE_UNMAPPED ? STAGE_UNMAPPED : lba + run * stage->blockSectors)){
+			run++;
+		}
+		if (lba == STAGE_UNMAPPED){
+			memset(buff + i * blockSize, 0, run * blockSize);
+		} else {
+			success = stageIo(stage->fd, false, buff + i * blockSize, lba * stage->sb.sectorSize, run * blockSize);
+		}
+		i += run;
+	}
+	pthread_rwlock_unlock(&stage->mapLock);
+	return success;
+}
+
+/// Make every write completed so far durable.  Returns success.
+bool stageSync(struct ZoneStage* stage){
+	if (fdatasync(stage->fd) < 0){
+		perror("Error flushing device");
+		return false;
+	}
+	return true;
+}
+
+/// Blocks that can be written to data zones without resetting any: the free zones and the rest of the current one
+static uint64_t stageFreeBlocks(const struct ZoneStage* stage){
+	uint64_t freeBlocks = 0;
+	for (uint32_t k = 0; k < stage->sb.numDataZones; k++){
+		if (k == stage->currZone){
+			freeBlocks += stage->zoneBlocks - stage->zoneWp[k];
+		} else if (stage->zoneWp[k] == 0){
+			freeBlocks += stage->zoneBlocks;
+		}
+	}
+	return freeBlocks;
+}
+
+/// Number of empty data zones
+uint32_t stageFreeZones(struct ZoneStage* stage){
+	uint32_t numFree = 0;
+	pthread_mutex_lock(&stage->destageLock);
+	for (uint32_t k = 0; k < stage->sb.numDataZones; k++){
+		numFree += stage->zoneWp[k] == 0;
+	}
+	pthread_mutex_unlock(&stage->destageLock);
+	return numFree;
+}
+
+/// Write the map blocks changed since the older checkpoint slot was written into that slot, then its header.
+/// The log tail recorded is the first record after the first dropRecords records, which are then released.
+/// Data zones no longer mapped by the checkpoint are reset afterwards.  Caller holds destageLock.
+/// Returns success.
+static bool stageCheckpoint(struct ZoneStage* stage, uint32_t dropRecords){
+	uint64_t seq = stage->checkpointSeq + 1;
+	uint32_t slot = seq % 2;
+	uint64_t tailBlock, tailSeq;
+	pthread_mutex_lock(&stage->logLock);
+	if (dropRecords < stage->numRecords){
+		tailBlock = stage->records[dropRecords].startBlock;
+		tailSeq = stage->records[dropRecords].seq;
+	} else {
+		tailBlock = stage->logHead;
+		tailSeq = stage->nextSeq;
+	}
+	pthread_mutex_unlock(&stage->logLock);
+
+	// Only writers change the map meanwhile, and log replay from the tail redoes their changes
+	uint32_t* resetZones = (uint32_t*) malloc(sizeof(uint32_t) * stage->sb.numDataZones);
+	if (!resetZones){
+		fprintf(stderr, "Error: Could not allocate zone list\n");
+		return false;
+	}
+	uint32_t numReset = 0;
+	pthread_rwlock_rdlock(&stage->mapLock);
+	for (uint32_t k = 0; k < stage->sb.numDataZones; k++){
+		if (k != stage->currZone && stage->zoneWp[k] > 0 && stage->zoneValid[k] == 0){
+			resetZones[numReset++] = k;
+		}
+	}
+	pthread_rwlock_unlock(&stage->mapLock);
+
+	size_t blockSize = stage->sb.blockSize;
+	uint64_t mapLba = stage->sb.checkpointLba[slot] + stage->blockSectors;
+	bool success = true;
+	for (uint64_t p = 0; success && p < stage->sb.mapBlocks; ){
+		pthread_rwlock_rdlock(&stage->mapLock);
+		while (p < stage->sb.mapBlocks && stage->pageGen[p] + 1 < seq){
+			p++;
+		}
+		uint64_t run = 0;
+		while (p + run < stage->sb.mapBlocks && run < STAGE_MOVE_BLOCKS && stage->pageGen[p + run] + 1 >= seq){
+			run++;
+		}
+		memcpy(stage->moveBuff, (uint8_t*)stage->map + p * blockSize, run * blockSize);
+		pthread_rwlock_unlock(&stage->mapLock);
+		if (run > 0){
+			success = stageIo(stage->fd, true, stage->moveBuff, (mapLba + p * stage->blockSectors) * stage->sb.sectorSize, run * blockSize);
+		}
+		p += run;
+	}
+	success = success
+		&& stageSync(stage)
+		&& stageWriteCheckpointHeader(stage->fd, &stage->sb, slot, seq, tailBlock, tailSeq, stage->moveBuff)
+		&& stageSync(stage);
+	if (!success){
+		free(resetZones);
+		return false;
+	}
+	pthread_rwlock_wrlock(&stage->mapLock);
+	stage->checkpointSeq = seq;
+	pthread_rwlock_unlock(&stage->mapLock);
+
+	pthread_mutex_lock(&stage->logLock);
+	for (uint32_t i = 0; i < dropRecords; i++){
+		stage->logUsed -= stage->records[i].footprint;
+	}
+	memmove(stage->records, stage->records + dropRecords, sizeof(struct StageRecord) * (stage->numRecords - dropRecords));
+	stage->numRecords -= dropRecords;
+	pthread_cond_broadcast(&stage->spaceCond);
+	pthread_mutex_unlock(&stage->logLock);
+
+	for (uint32_t i = 0; success && i < numReset; i++){
+		success = zoneDevResetWritePointer(&stage->dev, stageZoneLba(stage, resetZones[i]), false);
+		if (success){
+			stage->zoneWp[resetZones[i]] = 0;
+			stage->zonesReset++;
+		}
+	}
+	free(resetZones);
+	return success;
+}
+
+/// Append the blocks of moves, in order, at the write pointer of the current data zone (opening free zones as
+/// needed) and fill in their new LBAs.  Runs of consecutive source LBAs are read in one transfer.
+/// Caller holds destageLock.  Returns success.
+static bool stageMoveBlocks(struct ZoneStage* stage, struct StageMove* moves, uint64_t numMoves){
+	size_t blockSize = stage->sb.blockSize;
+	for (uint64_t i = 0; i < numMoves; ){
+		if (stage->currZone == ZONETABLE_NONE || stage->zoneWp[stage->currZone] == stage->zoneBlocks){
+			stage->currZone = ZONETABLE_NONE;
+			for (uint32_t k = 0; k < stage->sb.numDataZones && stage->currZone == ZONETABLE_NONE; k++){
+				if (stage->zoneWp[k] == 0){
+					stage->currZone = k;
+				}
+			}
+			if (stage->currZone == ZONETABLE_NONE){
+				fprintf(stderr, "Error: No free data zone to destage to\n");
+				return false;
+			}
+		}
+		uint32_t room = stage->zoneBlocks - stage->zoneWp[stage->currZone];
+		uint32_t count = numMoves - i < STAGE_MOVE_BLOCKS ? numMoves - i : STAGE_MOVE_BLOCKS;
+		count = count < room ? count : room;
+		for (uint32_t j = 0; j < count; ){
+			uint32_t run = 1;
+			while (j + run < count && moves[i + j + run].srcLba == moves[i + j].srcLba + run * stage->blockSectors){
+				run++;
+			}
+			if (!stageIo(stage->fd, false, stage->moveBuff + j * blockSize, moves[i + j].srcLba * stage->sb.sectorSize, run * blockSize)){
+				return false;
+			}
+			j += run;
+		}
+		uint64_t dstLba = stageZoneLba(stage, stage->currZone) + (uint64_t)stage->zoneWp[stage->currZone] * stage->blockSectors;
+		if (!stageIo(stage->fd, true, stage->moveBuff, dstLba * stage->sb.sectorSize, count * blockSize)){
+			return false;
+		}
+		for (uint32_t j = 0; j < count; j++){
+			moves[i + j].dstLba = dstLba + j * stage->blockSectors;
+		}
+		stage->zoneWp[stage->currZone] += count;
+		i += count;
+	}
+	return stageSync(stage);
+}
+
+/// Point each moved block at its new LBA, unless it was rewritten since.  Returns the number of blocks remapped.
+static uint64_t stageRemap(struct ZoneStage* stage, const struct StageMove* moves, uint64_t numMoves){
+	uint64_t remapped = 0;
+	pthread_rwlock_wrlock(&stage->mapLock);
+	for (uint64_t i = 0; i < numMoves; i++){
+		if (stage->map[moves[i].logicalBlock] == moves[i].srcLba){
+			stageSetMapping(stage, moves[i].logicalBlock, moves[i].dstLba);
+			remapped++;
+		}
+	}
+	pthread_rwlock_unlock(&stage->mapLock);
+	return remapped;
+}
+
+static int compareMoveLogical(const void* a, const void* b){
+	const struct StageMove* x = (const struct StageMove*)a;
+	const struct StageMove* y = (const struct StageMove*)b;
+	return (x->logicalBlock > y->logicalBlock) - (x->logicalBlock < y->logicalBlock);
+}
+
+static int compareMoveSource(const void* a, const void* b){
+	const struct StageMove* x = (const struct StageMove*)a;
+	const struct StageMove* y = (const struct StageMove*)b;
+	return (x->srcLba > y->srcLba) - (x->srcLba < y->srcLba);
+}
+
+/// Make room for needed blocks in the data zones.  Zones whose blocks were all rewritten are reset; otherwise the
+/// blocks still mapped into the zone with the fewest are relocated to the current zone, and it is reset.
+/// Caller holds destageLock.  Returns success.
+static bool stageReclaim(struct ZoneStage* stage, uint64_t needed){
+	while (stageFreeBlocks(stage) < needed){
+		uint32_t victim = ZONETABLE_NONE;
+		uint32_t fewest = UINT32_MAX;
+		pthread_rwlock_rdlock(&stage->mapLock);
+		for (uint32_t k = 0; k < stage->sb.numDataZones; k++){
+			if (k != stage->currZone && stage->zoneWp[k] > 0 && stage->zoneValid[k] < fewest){
+				victim = k;
+				fewest = stage->zoneValid[k];
+			}
+		}
+		pthread_rwlock_unlock(&stage->mapLock);
+		if (victim == ZONETABLE_NONE || fewest >= stage->zoneBlocks){
+			fprintf(stderr, "Error: No data zone to reclaim, the staged volume is full\n");
+			return false;
+		}
+
+		if (fewest > 0){
+			struct StageMove* moves = (struct StageMove*) malloc(sizeof(struct StageMove) * fewest);
+			if (!moves){
+				fprintf(stderr, "Error: Could not allocate relocation list\n");
+				return false;
+			}
+			// Blocks only leave the zone meanwhile, so at most fewest are found
+			uint64_t startLba = stageZoneLba(stage, victim);
+			uint64_t numMoves = 0;
+			pthread_rwlock_rdlock(&stage->mapLock);
+			for (uint64_t block = 0; block < stage->sb.numBlocks && numMoves < fewest; block++){
+				uint64_t lba = stage->map[block];
+				if (lba != STAGE_UNMAPPED && lba >= startLba && lba < startLba + stage->sb.zoneSectors){
+					moves[numMoves].logicalBlock = block;
+					moves[numMoves].srcLba = lba;
+					numMoves++;
+				}
+			}
+			pthread_rwlock_unlock(&stage->mapLock);
+			qsort(moves, numMoves, sizeof(struct StageMove), compareMoveSource);
+			bool success = stageMoveBlocks(stage, moves, numMoves);
+			if (success){
+				stage->blocksRelocated += stageRemap(stage, moves, numMoves);
+			}
+			free(moves);
+			if (!success){
+				return false;
+			}
+		}
+		// The zone may only be reset once a checkpoint no longer maps into it
+		if (!stageCheckpoint(stage, 0)){
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Destage the records logged so far: move the latest copy of each staged block to the data zones in logical
+/// block order, checkpoint, and release their log space.  Caller holds destageLock.  Returns success.
+static bool stageDestage(struct ZoneStage* stage){
+	pthread_mutex_lock(&stage->logLock);
+	uint32_t numRecords = stage->numRecords;
+	struct StageRecord* records = (struct StageRecord*) malloc(sizeof(struct StageRecord) * (numRecords ? numRecords : 1));
+	if (records){
+		memcpy(records, stage->records, sizeof(struct StageRecord) * numRecords);
+	}
+	pthread_mutex_unlock(&stage->logLock);
+	if (!records){
+		fprintf(stderr, "Error: Could not allocate log record list\n");
+		return false;
+	}
+	if (numRecords == 0){
+		free(records);
+		return true;
+	}
+
+	uint64_t numBlocks = 0;
+	for (uint32_t i = 0; i < numRecords; i++){
+		numBlocks += records[i].numBlocks;
+	}
+	struct StageMove* moves = (struct StageMove*) malloc(sizeof(struct StageMove) * numBlocks);
+	if (!moves){
+		fprintf(stderr, "Error: Could not allocate destage list\n");
+		free(records);
+		return false;
+	}
+	// Blocks rewritten by a later record are no longer mapped to the earlier copy
+	uint64_t numMoves = 0;
+	pthread_rwlock_rdlock(&stage->mapLock);
+	for (uint32_t i = 0; i < numRecords; i++){
+		for (uint32_t j = 0; j < records[i].numBlocks; j++){
+			uint64_t lba = stageLogLba(stage, records[i].dataBlock + j);
+			if (stage->map[records[i].logicalBlock + j] == lba){
+				moves[numMoves].logicalBlock = records[i].logicalBlock + j;
+				moves[numMoves].srcLba = lba;
+				numMoves++;
+			}
+		}
+	}
+	pthread_rwlock_unlock(&stage->mapLock);
+	free(records);
+	qsort(moves, numMoves, sizeof(struct StageMove), compareMoveLogical);
+
+	// Keeping a zone's worth free afterwards guarantees the next relocation fits
+	bool success = stageReclaim(stage, numMoves + stage->zoneBlocks) && stageMoveBlocks(stage, moves, numMoves);
+	if (success){
+		stage->blocksDestaged += stageRemap(stage, moves, numMoves);
+		success = stageCheckpoint(stage, numRecords);
+	}
+	free(moves);
+	return success;
+}
+
+/// Destaging thread.  Destages whenever the log passes the watermark, until the volume is closed or fails.
+static void* stageDestager(void* arg){
+	struct ZoneStage* stage = (struct ZoneStage*)arg;
+	pthread_mutex_lock(&stage->logLock);
+	while (!stage->stopping && !stage->failed){
+		if (stage->logUsed * STAGE_DESTAGE_WATERMARK < stage->sb.logBlocks){
+			pthread_cond_wait(&stage->destageCond, &stage->logLock);
+			continue;
+		}
+		pthread_mutex_unlock(&stage->logLock);
+		pthread_mutex_lock(&stage->destageLock);
+		bool success = stageDestage(stage);
+		pthread_mutex_unlock(&stage->destageLock);
+		pthread_mutex_lock(&stage->logLock);
+		if (!success){
+			stage->failed = true;
+			pthread_cond_broadcast(&stage->spaceCond);
+		}
+	}
+	pthread_mutex_unlock(&stage->logLock);
+	return NULL;
+}
+
+/// Destage every write logged so far.  Returns success.
+bool stageFlush(struct ZoneStage* stage){
+	pthread_mutex_lock(&stage->destageLock);
+	bool success = !stage->failed && stageDestage(stage);
+	pthread_mutex_unlock(&stage->destageLock);
+	if (!success){
+		pthread_mutex_lock(&stage->logLock);
+		stage->failed = true;
+		pthread_cond_broadcast(&stage->spaceCond);
+		pthread_mutex_unlock(&stage->logLock);
+	}
+	return success;
+}
+
+/// Stop the destaging thread, destage the log and close the volume.  Returns whether everything was destaged.
+bool stageClose(struct ZoneStage* stage){
+	pthread_mutex_lock(&stage->logLock);
+	stage->stopping = true;
+	pthread_cond_signal(&stage->destageCond);
+	pthread_mutex_unlock(&stage->logLock);
+	if (stage->destagerStarted){
+		pthread_join(stage->destager, NULL);
+	}
+	bool success = stageFlush(stage);
+	stageRelease(stage);
+	return success;
+}
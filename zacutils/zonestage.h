@@ -0,0 +1,162 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for the CMR staging layer.  Writes to a block-addressed volume are logged into the conventional (CMR)
+ * zones, then destaged in the background, sorted and coalesced, to the write pointer of the sequential zones.
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_ZONESTAGE_H
+#define ZACUTILS_ZONESTAGE_H
+
+#include <pthread.h>
+#include "zonetable.h"
+#include "zonecopy.h"
+#include "crc32c.h"
+
+/// First 8 bytes of the superblock, checkpoint headers and log records
+#define STAGE_SUPERBLOCK_MAGIC "ZACSTAGE"
+#define STAGE_CHECKPOINT_MAGIC "ZACSCKPT"
+#define STAGE_RECORD_MAGIC "ZACSLOG1"
+
+#define STAGE_VERSION 1
+
+/// Smallest and default volume block size, in bytes.  The superblock is read in one such block.
+#define STAGE_MIN_BLOCK_SIZE 4096
+#define STAGE_DEFAULT_BLOCK_SIZE 4096
+
+/// Mapping of a logical block that was never written
+#define STAGE_UNMAPPED UINT64_MAX
+
+/// Largest write logged in one record, in blocks.  Larger writes are split into several records.
+#define STAGE_MAX_RECORD_BLOCKS 64
+
+/// Smallest log, in blocks
+#define STAGE_MIN_LOG_BLOCKS (4 * (STAGE_MAX_RECORD_BLOCKS + 1))
+
+/// Blocks moved per destage or relocation transfer
+#define STAGE_MOVE_BLOCKS 256
+
+/// The destager starts once 1/STAGE_DESTAGE_WATERMARK of the log is in use
+#define STAGE_DESTAGE_WATERMARK 2
+
+/// Log record types
+enum StageRecordTypes {
+	STAGE_RECORD_WRITE = 1,		// Header block followed by numBlocks data blocks
+	STAGE_RECORD_WRAP = 2		// Header block only; the log continues at its start
+};
+
+/// Superblock, at the start of the first run of CMR zones.
+/// It is followed by two checkpoint slots (a header block and mapBlocks map blocks each), then the log.
+struct StageSuperblock {
+	char magic[8];
+	uint32_t version;
+	uint32_t blockSize;
+	uint32_t sectorSize;
+	uint32_t mapBlocks;		// Blocks of the mapping table in each checkpoint slot
+	uint64_t volumeId;		// Random, to tell records of this volume from those of a previous format
+	uint64_t numBlocks;		// Logical blocks of the volume
+	uint64_t metaLba;		// LBA of the superblock
+	uint64_t checkpointLba[2];
+	uint64_t logLba;
+	uint64_t logBlocks;
+	uint64_t dataLba;		// Start LBA of the first data (sequential) zone
+	uint64_t zoneSectors;		// Data zone length, in sectors
+	uint32_t numDataZones;
+	uint32_t reserveZones;		// Data zones kept out of the volume size, so destaging and relocation always fit
+	uint32_t _reserved;
+	uint32_t crc;			// CRC32C of the superblock with crc set to 0
+};
+
+/// Checkpoint slot header.  The valid slot with the larger seq holds the latest mapping table.
+struct StageCheckpointHeader {
+	char magic[8];
+	uint64_t volumeId;
+	uint64_t seq;
+	uint64_t tailBlock;		// Log block of the oldest record not yet destaged, where replay starts
+	uint64_t tailSeq;		// Sequence number of that record
+	uint32_t _reserved;
+	uint32_t crc;
+};
+
+/// Log record header, in a block of its own
+struct StageRecordHeader {
+	char magic[8];
+	uint64_t volumeId;
+	uint64_t seq;			// Consecutive across records; replay stops at the first gap
+	uint64_t logicalBlock;
+	uint32_t numBlocks;
+	uint32_t type;
+	uint32_t dataCrc;		// CRC32C of the data blocks
+	uint32_t crc;			// CRC32C of the header with crc set to 0
+};
+
+/// Record in the log that is not yet destaged
+struct StageRecord {
+	uint64_t logicalBlock;
+	uint64_t dataBlock;		// Log block of the first data block
+	uint64_t startBlock;		// Log block of the record, or of the wrap record preceding it
+	uint64_t seq;			// Sequence number at startBlock
+	uint32_t numBlocks;
+	uint32_t footprint;		// Log blocks used, including any skipped at the end of the log before wrapping
+};
+
+/// Block being moved into a data zone by destaging or relocation
+struct StageMove {
+	uint64_t logicalBlock;
+	uint64_t srcLba;
+	uint64_t dstLba;
+};
+
+/// Open staged volume.
+/// mapLock guards map, pageGen and zoneValid; readers hold it across their reads, so a location cannot be reused
+/// while it is read.  logLock serializes log appends and guards the log state and record list.  Zone write
+/// pointers, the current data zone and the checkpoints are only touched by the destaging thread (destageLock).
+struct ZoneStage {
+	struct ZoneDevice dev;
+	int fd;				// O_DIRECT data handle
+	struct StageSuperblock sb;
+	uint32_t blockSectors;
+	uint32_t zoneBlocks;
+	uint32_t entriesPerBlock;	// Mapping table entries per map block
+
+	uint64_t* map;			// Logical block to LBA (in the log or a data zone), or STAGE_UNMAPPED
+	uint64_t* pageGen;		// Per map block, the checkpoint that must write it (checkpointSeq+1 when changed)
+	uint32_t* zoneValid;		// Per data zone, logical blocks mapped into it
+	uint32_t* zoneWp;		// Per data zone, blocks written
+	uint32_t currZone;		// Data zone being filled, or ZONETABLE_NONE
+	uint64_t checkpointSeq;		// Last checkpoint written
+
+	uint64_t logHead;		// Log block where the next record goes
+	uint64_t logUsed;		// Log blocks used by records not yet destaged
+	uint64_t nextSeq;
+	struct StageRecord* records;
+	uint32_t numRecords;
+	uint32_t recordCapacity;
+	uint8_t* logBuff;		// Header and data of one record
+	uint8_t* moveBuff;		// STAGE_MOVE_BLOCKS blocks
+
+	pthread_mutex_t logLock;
+	pthread_rwlock_t mapLock;
+	pthread_mutex_t destageLock;
+	pthread_cond_t destageCond;	// Signalled when the log passes the watermark
+	pthread_cond_t spaceCond;	// Broadcast when log space is freed
+	pthread_t destager;
+	bool destagerStarted;
+	bool stopping;
+	volatile bool failed;
+
+	uint64_t recordsReplayed;
+	uint64_t blocksDestaged;
+	uint64_t blocksRelocated;
+	uint64_t zonesReset;
+};
+
+bool stageFormat(const char* deviceFile, enum ZoneBackends backend, uint32_t blockSize, uint32_t maxDataZones, struct StageSuperblock* sb);
+bool stageOpen(struct ZoneStage* stage, const char* deviceFile, enum ZoneBackends backend);
+bool stageWrite(struct ZoneStage* stage, uint64_t block, const uint8_t* buff, uint32_t numBlocks);
+bool stageRead(struct ZoneStage* stage, uint64_t block, uint8_t* buff, uint32_t numBlocks);
+bool stageSync(struct ZoneStage* stage);
+bool stageFlush(struct ZoneStage* stage);
+bool stageClose(struct ZoneStage* stage);
+uint32_t stageFreeZones(struct ZoneStage* stage);
+
+#endif
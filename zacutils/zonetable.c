@@ -0,0 +1,406 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Columnar in-memory zone table, decoded from REPORT ZONES DMA buffers
+ */
+#include "zonetable.h"
+
+/// Allocate an empty table able to hold capacity zones.  Returns success.
+bool zoneTableInit(struct ZoneTable* table, uint32_t capacity){
+	memset(table, 0, sizeof(*table));
+	table->capacity = capacity;
+	table->oddZone = ZONETABLE_NONE;
+	table->wpOffsets = (uint32_t*) malloc(sizeof(uint32_t) * (capacity ? capacity : 1));
+	table->flags = (uint8_t*) malloc(sizeof(uint8_t) * (capacity ? capacity : 1));
+	if (!table->wpOffsets || !table->flags){
+		fprintf(stderr, "Error: Could not allocate zone table for %u zones\n", capacity);
+		zoneTableFree(table);
+		return false;
+	}
+	return true;
+}
+
+void zoneTableFree(struct ZoneTable* table){
+	free(table->zoneIndex);
+	free(table->startLbas);
+	free(table->lengths);
+	free(table->wpOffsets);
+	free(table->checkpoints);
+	free(table->tailCrcs);
+	free(table->flags);
+	memset(table, 0, sizeof(*table));
+	table->oddZone = ZONETABLE_NONE;
+}
+
+/// Convert a uniform-layout table to explicit start LBA and length columns.  Returns success.
+static bool zoneTableMaterialize(struct ZoneTable* table){
+	uint64_t* startLbas = (uint64_t*) malloc(sizeof(uint64_t) * table->capacity);
+	uint32_t* lengths = (uint32_t*) malloc(sizeof(uint32_t) * table->capacity);
+	if (!startLbas || !lengths){
+		fprintf(stderr, "Error: Could not allocate zone table for %u zones\n", table->capacity);
+		free(startLbas);
+		free(lengths);
+		return false;
+	}
+	if (table->zoneLength > UINT32_MAX || table->oddZoneLength > UINT32_MAX){
+		fprintf(stderr, "Error: Zone length exceeds %u sectors\n", UINT32_MAX);
+		free(startLbas);
+		free(lengths);
+		return false;
+	}
+	for (uint32_t i=0; i<table->numZones; i++){
+		startLbas[i] = zoneTableStartLba(table, i);
+		lengths[i] = zoneTableLength(table, i);
+	}
+	free(table->zoneIndex);
+	table->zoneIndex = NULL;
+	table->startLbas = startLbas;
+	table->lengths = lengths;
+	table->zoneLength = 0;
+	table->oddZone = ZONETABLE_NONE;
+	return true;
+}
+
+/// Place the zone starting at startLba with length zoneLength at the end of the table.  Returns success.
+static bool zoneTableAppendExtent(struct ZoneTable* table, uint64_t startLba, uint64_t zoneLength){
+	uint32_t i = table->numZones;
+	if (!table->startLbas){
+		if (i == 0 && zoneLength != 0){
+			table->baseLba = startLba;
+			table->zoneLength = zoneLength;
+			return true;
+		}
+		uint64_t idx = 0;
+		bool aligned = false;
+		if (i > 0 && startLba >= table->baseLba){
+			idx = (startLba - table->baseLba) / table->zoneLength;
+			aligned = (startLba - table->baseLba) % table->zoneLength == 0 && idx < UINT32_MAX;
+		}
+		// Only one zone (normally the last) may differ in length from the first
+		bool sameLength = zoneLength == table->zoneLength || table->oddZone == ZONETABLE_NONE;
+		if (aligned && sameLength){
+			if (idx != i && !table->zoneIndex){
+				// Zones stopped being contiguous, so start recording zone indices
+				table->zoneIndex = (uint32_t*) malloc(sizeof(uint32_t) * table->capacity);
+				if (!table->zoneIndex){
+					fprintf(stderr, "Error: Could not allocate zone table for %u zones\n", table->capacity);
+					return false;
+				}
+				for (uint32_t j=0; j<i; j++){
+					table->zoneIndex[j] = j;
+				}
+			}
+			if (table->zoneIndex){
+				table->zoneIndex[i] = idx;
+			}
+			if (zoneLength != table->zoneLength){
+				table->oddZone = i;
+				table->oddZoneLength = zoneLength;
+			}
+			return true;
+		}
+		if (!zoneTableMaterialize(table)){
+			return false;
+		}
+	}
+	if (zoneLength > UINT32_MAX){
+		fprintf(stderr, "Error: Zone length exceeds %u sectors\n", UINT32_MAX);
+		return false;
+	}
+	table->startLbas[i] = startLba;
+	table->lengths[i] = zoneLength;
+	return true;
+}
+
+/// Append one REPORT ZONES DMA record to the table.  Returns success.
+bool zoneTableAppend(struct ZoneTable* table, const struct ReportZonesEntry* entry){
+	uint32_t i = table->numZones;
+	if (i >= table->capacity){
+		fprintf(stderr, "Error: Zone table full (%u zones)\n", table->capacity);
+		return false;
+	}
+	if (!zoneTableAppendExtent(table, entry->zoneStartLba, entry->zoneLength)){
+		return false;
+	}
+
+	uint64_t wp = entry->writePointer;
+	if (wp >= entry->zoneStartLba && wp - entry->zoneStartLba < ZONETABLE_WP_NONE){
+		table->wpOffsets[i] = wp - entry->zoneStartLba;
+	} else {
+		table->wpOffsets[i] = ZONETABLE_WP_NONE;
+	}
+
+	if (entry->checkpoint != 0 && !table->checkpoints){
+		table->checkpoints = (uint64_t*) calloc(table->capacity, sizeof(uint64_t));
+		if (!table->checkpoints){
+			fprintf(stderr, "Error: Could not allocate zone table for %u zones\n", table->capacity);
+			return false;
+		}
+	}
+	if (table->checkpoints){
+		table->checkpoints[i] = entry->checkpoint;
+	}
+
+	uint8_t zoneType = entry->options & 0xF;
+	uint8_t zoneCon = (entry->options >> 12) & 0xF;
+	uint8_t resetBit = (entry->options >> 8) & 0x1;
+	if (zoneType > ZONEFLAG_TYPE_MASK){	// Reserved
+		zoneType = 0;
+	}
+	table->flags[i] = zoneType | (zoneCon << ZONEFLAG_COND_SHIFT) | (resetBit ? ZONEFLAG_RESET : 0);
+
+	table->numZones++;
+	return true;
+}
+
+/// Allocate the tail checksum column, with every checksum 0.  Returns success.
+bool zoneTableInitTailCrcs(struct ZoneTable* table){
+	if (table->tailCrcs){
+		return true;
+	}
+	table->tailCrcs = (uint32_t*) calloc(table->capacity ? table->capacity : 1, sizeof(uint32_t));
+	if (!table->tailCrcs){
+		fprintf(stderr, "Error: Could not allocate zone table for %u zones\n", table->capacity);
+		return false;
+	}
+	return true;
+}
+
+/// Decode up to maxEntries records from a raw REPORT ZONES DMA buffer (header included) into the table.
+/// The number of records decoded is stored in numDecoded.  Returns success.
+bool zoneTableDecode(struct ZoneTable* table, const uint8_t* buff, unsigned int buffLen, uint32_t maxEntries, uint32_t* numDecoded){
+	*numDecoded = 0;
+	if (buffLen < sizeof(struct ReportZonesHeader)){
+		return true;
+	}
+	const struct ReportZonesHeader* header = (const struct ReportZonesHeader*)buff;
+	const struct ReportZonesEntry* entries = (const struct ReportZonesEntry*)(&buff[sizeof(struct ReportZonesHeader)]);
+	uint32_t numEntries = header->zoneListLength / sizeof(struct ReportZonesEntry);
+	uint32_t buffEntries = (buffLen - sizeof(struct ReportZonesHeader)) / sizeof(struct ReportZonesEntry);
+	if (numEntries > buffEntries){
+		numEntries = buffEntries;
+	}
+	if (numEntries > maxEntries){
+		numEntries = maxEntries;
+	}
+	for (uint32_t i=0; i<numEntries; i++){
+		if (!zoneTableAppend(table, &entries[i])){
+			return false;
+		}
+		(*numDecoded)++;
+	}
+	return true;
+}
+
+/// BLKREPORTZONE version of zoneTableFetch, which decodes kernel zone descriptors straight into the table in
+/// batches of up to BLK_REPORT_BATCH zones.  Returns success.
+static bool zoneTableFetchBlk(struct ZoneDevice* dev, struct ZoneTable* table, uint64_t startLba, uint8_t reportingOptions, uint32_t maxZones){
+	struct blk_zone_report* report = (struct blk_zone_report*) malloc(sizeof(struct blk_zone_report) + sizeof(struct blk_zone) * BLK_REPORT_BATCH);
+	if (!report){
+		fprintf(stderr, "Error: Could not allocate BLKREPORTZONE buffer\n");
+		return false;
+	}
+
+	// Like REPORT ZONES DMA, start from the zone containing startLba
+	uint64_t sector = startLba << dev->lbaShift;
+	sector -= sector % dev->zoneSectors;
+	uint32_t retrieved = 0;
+	struct ReportZonesEntry entry;
+	while (retrieved < maxZones && sector < dev->capacitySectors){
+		memset(report, 0, sizeof(struct blk_zone_report));
+		report->sector = sector;
+		report->nr_zones = BLK_REPORT_BATCH;
+		if (reportingOptions == ROPT_ALL && maxZones - retrieved < BLK_REPORT_BATCH){
+			report->nr_zones = maxZones - retrieved;
+		}
+		if (ioctl(dev->fd, BLKREPORTZONE, report) < 0){
+			perror("BLKREPORTZONE error");
+			free(report);
+			return false;
+		}
+		if (report->nr_zones == 0){
+			break;
+		}
+		for (uint32_t i=0; i<report->nr_zones && retrieved < maxZones; i++){
+			if (!zoneDevBlkZoneMatches(&report->zones[i], reportingOptions)){
+				continue;
+			}
+			zoneDevBlkZoneToEntry(dev, &report->zones[i], &entry);
+			if (!zoneTableAppend(table, &entry)){
+				free(report);
+				return false;
+			}
+			retrieved++;
+		}
+		struct blk_zone* lastZone = &report->zones[report->nr_zones-1];
+		sector = lastZone->start + lastZone->len;
+	}
+	free(report);
+	return true;
+}
+
+/// Retrieve up to maxZones zones starting from the zone containing startLba into the table, in chunks of
+/// REPORT_ZONES_ENTRY_BUFFER_SIZE records (or larger kernel batches with BACKEND_BLK).  Returns success.
+bool zoneTableFetch(struct ZoneDevice* dev, struct ZoneTable* table, uint64_t startLba, uint8_t reportingOptions, uint32_t maxZones){
+	if (dev->backend == BACKEND_BLK){
+		return zoneTableFetchBlk(dev, table, startLba, reportingOptions, maxZones);
+	}
+	unsigned int buffLen = sizeof(struct ReportZonesHeader) + sizeof(struct ReportZonesEntry)*REPORT_ZONES_ENTRY_BUFFER_SIZE;
+	uint16_t pagesRequested = buffLen/512 + (buffLen%512 == 0 ? 0 : 1);
+	buffLen = pagesRequested * 512;
+	uint8_t* dataBuff = (uint8_t*) malloc(buffLen);
+	if (!dataBuff){
+		fprintf(stderr, "Error: Could not allocate REPORT ZONES DMA buffer\n");
+		return false;
+	}
+
+	uint64_t currLba = startLba;
+	uint32_t retrieved = 0;
+	while (retrieved < maxZones){
+		memset(dataBuff, 0, buffLen);
+		if (!zoneDevReportZones(dev, currLba, reportingOptions, dataBuff, buffLen)){
+			free(dataBuff);
+			return false;
+		}
+
+		uint32_t numDecoded;
+		uint32_t firstNew = table->numZones;
+		if (!zoneTableDecode(table, dataBuff, buffLen, maxZones - retrieved, &numDecoded)){
+			free(dataBuff);
+			return false;
+		}
+		retrieved += numDecoded;
+		if (numDecoded < REPORT_ZONES_ENTRY_BUFFER_SIZE){
+			break;	// Device had no more zones to report
+		}
+		uint32_t last = firstNew + numDecoded - 1;
+		currLba = zoneTableStartLba(table, last) + zoneTableLength(table, last);
+	}
+	free(dataBuff);
+	return true;
+}
+
+/// Initialize the table and retrieve every zone of the device into it, storing the REPORT ZONES DMA header in
+/// header.  Returns success.
+bool zoneTableReportAll(struct ZoneDevice* dev, struct ZoneTable* table, struct ReportZonesHeader* header){
+	if (!zoneDevReportHeader(dev, 0, ROPT_ALL, header, NULL)){
+		return false;
+	}
+	uint32_t numZones = header->zoneListLength / sizeof(struct ReportZonesEntry);
+	if (!zoneTableInit(table, numZones)){
+		return false;
+	}
+	if (!zoneTableFetch(dev, table, 0, ROPT_ALL, numZones)){
+		zoneTableFree(table);
+		return false;
+	}
+	return true;
+}
+
+/// Write the table to file as a CSV zone manifest, with a tail checksum column if the table has tail checksums.
+/// Returns success.
+bool zoneTableSave(const struct ZoneTable* table, uint32_t sectorSize, FILE* file){
+	fprintf(file, "%s\n", table->tailCrcs ? ZONE_MANIFEST_MAGIC_TAILS : ZONE_MANIFEST_MAGIC);
+	fprintf(file, "Sector Size,Number of Zones\n");
+	fprintf(file, "%u,%u\n", sectorSize, table->numZones);
+	fprintf(file, "Zone Start LBA,Zone Length,Write Pointer,Checkpoint,Option Flags%s\n", table->tailCrcs ? ",Tail CRC32C" : "");
+	for (uint32_t i=0; i<table->numZones; i++){
+		fprintf(
+			file,
+			"%#lx,%#lx,%#lx,%#lx,%#x",
+			zoneTableStartLba(table, i),
+			zoneTableLength(table, i),
+			zoneTableWritePointer(table, i),
+			zoneTableCheckpoint(table, i),
+			zoneTableOptions(table, i)
+		);
+		if (table->tailCrcs){
+			fprintf(file, ",%#x", table->tailCrcs[i]);
+		}
+		fputc('\n', file);
+	}
+	fflush(file);
+	return !ferror(file);
+}
+
+/// Read a CSV zone manifest written by zoneTableSave into a newly initialized table.  Tail checksums are loaded
+/// if the manifest has them.  Returns success.
+bool zoneTableLoad(struct ZoneTable* table, uint32_t* sectorSize, FILE* file){
+	char line[256];
+	uint32_t numZones;
+	bool hasTails = false;
+	if (!fgets(line, sizeof(line), file)
+		|| (strncmp(line, ZONE_MANIFEST_MAGIC, strlen(ZONE_MANIFEST_MAGIC)) != 0
+			&& !(hasTails = strncmp(line, ZONE_MANIFEST_MAGIC_TAILS, strlen(ZONE_MANIFEST_MAGIC_TAILS)) == 0))
+		|| !fgets(line, sizeof(line), file)
+		|| !fgets(line, sizeof(line), file) || sscanf(line, "%u,%u", sectorSize, &numZones) != 2
+		|| !fgets(line, sizeof(line), file)){
+		fprintf(stderr, "Error: Invalid zone manifest header\n");
+		return false;
+	}
+	if (numZones > MAX_ZONES || !zoneTableInit(table, numZones)){
+		return false;
+	}
+	if (hasTails && !zoneTableInitTailCrcs(table)){
+		zoneTableFree(table);
+		return false;
+	}
+	struct ReportZonesEntry entry;
+	memset(&entry, 0, sizeof(entry));
+	for (uint32_t i=0; i<numZones; i++){
+		unsigned long startLba, zoneLength, writePointer, checkpoint;
+		unsigned int options;
+		unsigned int tailCrc = 0;
+		if (!fgets(line, sizeof(line), file)
+			|| sscanf(line, "%lx,%lx,%lx,%lx,%x,%x", &startLba, &zoneLength, &writePointer, &checkpoint, &options, &tailCrc) != (hasTails ? 6 : 5)){
+			fprintf(stderr, "Error: Invalid zone manifest entry %u\n", i+1);
+			zoneTableFree(table);
+			return false;
+		}
+		entry.zoneStartLba = startLba;
+		entry.zoneLength = zoneLength;
+		entry.writePointer = writePointer;
+		entry.checkpoint = checkpoint;
+		entry.options = options;
+		if (!zoneTableAppend(table, &entry)){
+			zoneTableFree(table);
+			return false;
+		}
+		if (hasTails){
+			table->tailCrcs[i] = tailCrc;
+		}
+	}
+	return true;
+}
+
+/// Returns whether both tables describe the same zones (start LBA, length and type)
+bool zoneTableSameLayout(const struct ZoneTable* a, const struct ZoneTable* b){
+	if (a->numZones != b->numZones){
+		return false;
+	}
+	for (uint32_t i=0; i<a->numZones; i++){
+		if (zoneTableStartLba(a, i) != zoneTableStartLba(b, i)
+			|| zoneTableLength(a, i) != zoneTableLength(b, i)
+			|| zoneTableType(a, i) != zoneTableType(b, i)){
+			return false;
+		}
+	}
+	return true;
+}
+
+/// Bytes of heap memory held by the table
+size_t zoneTableMemoryUsage(const struct ZoneTable* table){
+	size_t perZone = sizeof(uint32_t) + sizeof(uint8_t);
+	if (table->zoneIndex){
+		perZone += sizeof(uint32_t);
+	}
+	if (table->startLbas){
+		perZone += sizeof(uint64_t) + sizeof(uint32_t);
+	}
+	if (table->checkpoints){
+		perZone += sizeof(uint64_t);
+	}
+	if (table->tailCrcs){
+		perZone += sizeof(uint32_t);
+	}
+	return perZone * table->capacity;
+}
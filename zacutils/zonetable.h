@@ -0,0 +1,140 @@
+/**
+ * (c) 2026 zacutils contributors.
+ * Header for the columnar in-memory zone table
+ * Compliant to ZAC Specification draft, revision 0.8n (March 4, 2015)
+ */
+#ifndef ZACUTILS_ZONETABLE_H
+#define ZACUTILS_ZONETABLE_H
+
+#include "zonedev.h"
+
+/// Marks "no such zone" for zone indices
+#define ZONETABLE_NONE UINT32_MAX
+
+/// Write pointer offset stored for zones whose write pointer does not lie within the zone (e.g. CMR)
+#define ZONETABLE_WP_NONE UINT32_MAX
+
+/// Write pointer value reported back for zones stored with ZONETABLE_WP_NONE
+#define ZONE_WP_INVALID UINT64_MAX
+
+/// First line of a zone manifest written by zoneTableSave, without and with the tail checksum column
+#define ZONE_MANIFEST_MAGIC "zacutils zone manifest,1"
+#define ZONE_MANIFEST_MAGIC_TAILS "zacutils zone manifest,2"
+
+/// Bytes of written data, ending at the write pointer, covered by a zone's tail checksum (at least one sector)
+#define ZONE_TAIL_BYTES 4096
+
+/// Packed zone flags byte: type in bits 0-2, condition in bits 3-6, reset in bit 7
+#define ZONEFLAG_TYPE_MASK 0x07
+#define ZONEFLAG_COND_SHIFT 3
+#define ZONEFLAG_COND_MASK 0x0f
+#define ZONEFLAG_RESET 0x80
+
+/// Columnar zone table.
+/// While all zone lengths match the first zone (save for at most one zone, normally the last), start LBAs are
+/// implicit (baseLba + index*zoneLength).  If the zones are not contiguous (e.g. after filtering with reporting
+/// options), the index is delta-coded in units of zoneLength into zoneIndex.  Otherwise the table falls back to
+/// explicit startLbas/lengths columns.  Write pointers are stored as 32-bit offsets from the zone start, and the
+/// type/condition/reset fields are packed into one byte.  Checkpoints are stored only once a nonzero one is seen,
+/// and tail checksums only once zoneTableInitTailCrcs is called.
+struct ZoneTable {
+	uint32_t numZones;
+	uint32_t capacity;
+	uint64_t baseLba;		// Start LBA of the first zone (uniform layout)
+	uint64_t zoneLength;		// Common zone length (uniform layout), 0 once lengths are stored per zone
+	uint32_t oddZone;		// Index of the one zone with a different length (uniform layout), or ZONETABLE_NONE
+	uint64_t oddZoneLength;
+	uint32_t* zoneIndex;		// Uniform layout: (startLba - baseLba) / zoneLength.  NULL while zones are contiguous
+	uint64_t* startLbas;		// Explicit layout only
+	uint32_t* lengths;		// Explicit layout only
+	uint32_t* wpOffsets;
+	uint64_t* checkpoints;
+	uint32_t* tailCrcs;		// CRC32C of the last ZONE_TAIL_BYTES written in each zone, 0 if none written
+	uint8_t* flags;
+};
+
+bool zoneTableInit(struct ZoneTable* table, uint32_t capacity);
+void zoneTableFree(struct ZoneTable* table);
+bool zoneTableAppend(struct ZoneTable* table, const struct ReportZonesEntry* entry);
+bool zoneTableInitTailCrcs(struct ZoneTable* table);
+bool zoneTableDecode(struct ZoneTable* table, const uint8_t* buff, unsigned int buffLen, uint32_t maxEntries, uint32_t* numDecoded);
+bool zoneTableFetch(struct ZoneDevice* dev, struct ZoneTable* table, uint64_t startLba, uint8_t reportingOptions, uint32_t maxZones);
+bool zoneTableReportAll(struct ZoneDevice* dev, struct ZoneTable* table, struct ReportZonesHeader* header);
+bool zoneTableSave(const struct ZoneTable* table, uint32_t sectorSize, FILE* file);
+bool zoneTableLoad(struct ZoneTable* table, uint32_t* sectorSize, FILE* file);
+bool zoneTableSameLayout(const struct ZoneTable* a, const struct ZoneTable* b);
+size_t zoneTableMemoryUsage(const struct ZoneTable* table);
+
+/// Start LBA of zone i
+static inline uint64_t zoneTableStartLba(const struct ZoneTable* table, uint32_t i){
+	if (table->startLbas){
+		return table->startLbas[i];
+	}
+	return table->baseLba + (uint64_t)(table->zoneIndex ? table->zoneIndex[i] : i) * table->zoneLength;
+}
+
+/// Length of zone i, in sectors
+static inline uint64_t zoneTableLength(const struct ZoneTable* table, uint32_t i){
+	if (table->lengths){
+		return table->lengths[i];
+	}
+	return i == table->oddZone ? table->oddZoneLength : table->zoneLength;
+}
+
+/// Returns whether zone i has a write pointer within the zone
+static inline bool zoneTableHasWp(const struct ZoneTable* table, uint32_t i){
+	return table->wpOffsets[i] != ZONETABLE_WP_NONE;
+}
+
+/// Sectors between zone start and write pointer (0 if the zone has no write pointer)
+static inline uint32_t zoneTableWpOffset(const struct ZoneTable* table, uint32_t i){
+	return zoneTableHasWp(table, i) ? table->wpOffsets[i] : 0;
+}
+
+/// Write pointer LBA of zone i, or ZONE_WP_INVALID
+static inline uint64_t zoneTableWritePointer(const struct ZoneTable* table, uint32_t i){
+	if (!zoneTableHasWp(table, i)){
+		return ZONE_WP_INVALID;
+	}
+	return zoneTableStartLba(table, i) + table->wpOffsets[i];
+}
+
+static inline uint64_t zoneTableCheckpoint(const struct ZoneTable* table, uint32_t i){
+	return table->checkpoints ? table->checkpoints[i] : 0;
+}
+
+static inline uint32_t zoneTableTailCrc(const struct ZoneTable* table, uint32_t i){
+	return table->tailCrcs ? table->tailCrcs[i] : 0;
+}
+
+static inline uint8_t zoneTableType(const struct ZoneTable* table, uint32_t i){
+	return table->flags[i] & ZONEFLAG_TYPE_MASK;
+}
+
+static inline uint8_t zoneTableCondition(const struct ZoneTable* table, uint32_t i){
+	return (table->flags[i] >> ZONEFLAG_COND_SHIFT) & ZONEFLAG_COND_MASK;
+}
+
+static inline bool zoneTableReset(const struct ZoneTable* table, uint32_t i){
+	return table->flags[i] & ZONEFLAG_RESET;
+}
+
+/// Sectors of zone i holding data: none for offline zones, the whole zone for CMR, full or pointer-less zones,
+/// else up to the write pointer
+static inline uint64_t zoneTableWrittenLength(const struct ZoneTable* table, uint32_t i){
+	uint64_t length = zoneTableLength(table, i);
+	if (zoneTableCondition(table, i) == ZONECOND_OFFLINE){
+		return 0;
+	}
+	if (zoneTableType(table, i) == ZONETYPE_CMR || zoneTableCondition(table, i) == ZONECOND_FULL || !zoneTableHasWp(table, i)){
+		return length;
+	}
+	return table->wpOffsets[i] < length ? table->wpOffsets[i] : length;
+}
+
+/// Option flags of zone i in REPORT ZONES DMA record layout
+static inline uint16_t zoneTableOptions(const struct ZoneTable* table, uint32_t i){
+	return zoneTableType(table, i) | (zoneTableReset(table, i) << 8) | (zoneTableCondition(table, i) << 12);
+}
+
+#endif